@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Report.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct BenchOptions
+{
+    // Size of the sources parsed by the parse benchmarks
+    size_t megabytes = 8;
+    // Number of strings in the databases of the store benchmarks, and their backends
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+    std::vector<std::string> stores = {"binary", "sqlite"};
+    // Shape of the synthetic code bases spooled into those databases
+    size_t uses_per_file = 100;
+    double duplication = 0.5;
+    // Number of edited files analyzed into each database
+    size_t edits = 20;
+    // Minimum duration of each throughput measurement
+    double seconds = 1.0;
+    // Scratch directory for the databases
+    std::string directory;
+};
+
+// Parser::parse throughput
+void bench_parse(Report& report, const BenchOptions& options);
+
+// Populating, opening, analyzing a single file into and generating databases of each size and backend
+void bench_stores(Report& report, const BenchOptions& options);
+
+// Lookups and inserts in maps keyed by pooled strings and by std::string
+void bench_maps(Report& report, const BenchOptions& options);
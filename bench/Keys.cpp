@@ -0,0 +1,69 @@
+#include "Keys.hpp"
+
+#include <spool.h>
+
+// The only spooled source of spool_bench
+const char* const bench_keys[bench_key_count] = {
+    SP("audio.enabled"), SP("audio.quality"), SP("audio.resolution"), SP("audio.volume"), SP("audio.distance"),
+    SP("audio.scale"), SP("audio.offset"), SP("audio.threshold"), SP("audio.timeout"), SP("audio.max_count"),
+    SP("audio.min_count"), SP("audio.interval"), SP("audio.color"), SP("audio.opacity"), SP("audio.priority"),
+    SP("audio.label"),
+    SP("render.enabled"), SP("render.quality"), SP("render.resolution"), SP("render.volume"), SP("render.distance"),
+    SP("render.scale"), SP("render.offset"), SP("render.threshold"), SP("render.timeout"), SP("render.max_count"),
+    SP("render.min_count"), SP("render.interval"), SP("render.color"), SP("render.opacity"), SP("render.priority"),
+    SP("render.label"),
+    SP("input.enabled"), SP("input.quality"), SP("input.resolution"), SP("input.volume"), SP("input.distance"),
+    SP("input.scale"), SP("input.offset"), SP("input.threshold"), SP("input.timeout"), SP("input.max_count"),
+    SP("input.min_count"), SP("input.interval"), SP("input.color"), SP("input.opacity"), SP("input.priority"),
+    SP("input.label"),
+    SP("physics.enabled"), SP("physics.quality"), SP("physics.resolution"), SP("physics.volume"),
+    SP("physics.distance"), SP("physics.scale"), SP("physics.offset"), SP("physics.threshold"), SP("physics.timeout"),
+    SP("physics.max_count"), SP("physics.min_count"), SP("physics.interval"), SP("physics.color"),
+    SP("physics.opacity"), SP("physics.priority"), SP("physics.label"),
+    SP("network.enabled"), SP("network.quality"), SP("network.resolution"), SP("network.volume"),
+    SP("network.distance"), SP("network.scale"), SP("network.offset"), SP("network.threshold"), SP("network.timeout"),
+    SP("network.max_count"), SP("network.min_count"), SP("network.interval"), SP("network.color"),
+    SP("network.opacity"), SP("network.priority"), SP("network.label"),
+    SP("ui.enabled"), SP("ui.quality"), SP("ui.resolution"), SP("ui.volume"), SP("ui.distance"), SP("ui.scale"),
+    SP("ui.offset"), SP("ui.threshold"), SP("ui.timeout"), SP("ui.max_count"), SP("ui.min_count"), SP("ui.interval"),
+    SP("ui.color"), SP("ui.opacity"), SP("ui.priority"), SP("ui.label"),
+    SP("save.enabled"), SP("save.quality"), SP("save.resolution"), SP("save.volume"), SP("save.distance"),
+    SP("save.scale"), SP("save.offset"), SP("save.threshold"), SP("save.timeout"), SP("save.max_count"),
+    SP("save.min_count"), SP("save.interval"), SP("save.color"), SP("save.opacity"), SP("save.priority"),
+    SP("save.label"),
+    SP("script.enabled"), SP("script.quality"), SP("script.resolution"), SP("script.volume"), SP("script.distance"),
+    SP("script.scale"), SP("script.offset"), SP("script.threshold"), SP("script.timeout"), SP("script.max_count"),
+    SP("script.min_count"), SP("script.interval"), SP("script.color"), SP("script.opacity"), SP("script.priority"),
+    SP("script.label"),
+    SP("camera.enabled"), SP("camera.quality"), SP("camera.resolution"), SP("camera.volume"), SP("camera.distance"),
+    SP("camera.scale"), SP("camera.offset"), SP("camera.threshold"), SP("camera.timeout"), SP("camera.max_count"),
+    SP("camera.min_count"), SP("camera.interval"), SP("camera.color"), SP("camera.opacity"), SP("camera.priority"),
+    SP("camera.label"),
+    SP("light.enabled"), SP("light.quality"), SP("light.resolution"), SP("light.volume"), SP("light.distance"),
+    SP("light.scale"), SP("light.offset"), SP("light.threshold"), SP("light.timeout"), SP("light.max_count"),
+    SP("light.min_count"), SP("light.interval"), SP("light.color"), SP("light.opacity"), SP("light.priority"),
+    SP("light.label"),
+    SP("shadow.enabled"), SP("shadow.quality"), SP("shadow.resolution"), SP("shadow.volume"), SP("shadow.distance"),
+    SP("shadow.scale"), SP("shadow.offset"), SP("shadow.threshold"), SP("shadow.timeout"), SP("shadow.max_count"),
+    SP("shadow.min_count"), SP("shadow.interval"), SP("shadow.color"), SP("shadow.opacity"), SP("shadow.priority"),
+    SP("shadow.label"),
+    SP("particle.enabled"), SP("particle.quality"), SP("particle.resolution"), SP("particle.volume"),
+    SP("particle.distance"), SP("particle.scale"), SP("particle.offset"), SP("particle.threshold"),
+    SP("particle.timeout"), SP("particle.max_count"), SP("particle.min_count"), SP("particle.interval"),
+    SP("particle.color"), SP("particle.opacity"), SP("particle.priority"), SP("particle.label"),
+    SP("terrain.enabled"), SP("terrain.quality"), SP("terrain.resolution"), SP("terrain.volume"),
+    SP("terrain.distance"), SP("terrain.scale"), SP("terrain.offset"), SP("terrain.threshold"), SP("terrain.timeout"),
+    SP("terrain.max_count"), SP("terrain.min_count"), SP("terrain.interval"), SP("terrain.color"),
+    SP("terrain.opacity"), SP("terrain.priority"), SP("terrain.label"),
+    SP("water.enabled"), SP("water.quality"), SP("water.resolution"), SP("water.volume"), SP("water.distance"),
+    SP("water.scale"), SP("water.offset"), SP("water.threshold"), SP("water.timeout"), SP("water.max_count"),
+    SP("water.min_count"), SP("water.interval"), SP("water.color"), SP("water.opacity"), SP("water.priority"),
+    SP("water.label"),
+    SP("sky.enabled"), SP("sky.quality"), SP("sky.resolution"), SP("sky.volume"), SP("sky.distance"), SP("sky.scale"),
+    SP("sky.offset"), SP("sky.threshold"), SP("sky.timeout"), SP("sky.max_count"), SP("sky.min_count"),
+    SP("sky.interval"), SP("sky.color"), SP("sky.opacity"), SP("sky.priority"), SP("sky.label"),
+    SP("debug.enabled"), SP("debug.quality"), SP("debug.resolution"), SP("debug.volume"), SP("debug.distance"),
+    SP("debug.scale"), SP("debug.offset"), SP("debug.threshold"), SP("debug.timeout"), SP("debug.max_count"),
+    SP("debug.min_count"), SP("debug.interval"), SP("debug.color"), SP("debug.opacity"), SP("debug.priority"),
+    SP("debug.label"),
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+// Settings-like keys pooled by SP, for the runtime benchmarks
+constexpr size_t bench_key_count = 256;
+extern const char* const bench_keys[bench_key_count];
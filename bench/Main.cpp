@@ -0,0 +1,151 @@
+// Benchmarks for the spooler and the runtime. Run `spool_bench [options]` from a release build. Passing --json writes
+// the results to a file as well, so that the results of a spooler upgrade can be compared with those before it.
+
+#include "Benchmarks.hpp"
+#include "Report.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static void print_help()
+{
+    std::printf(
+        "Usage:\n"
+        "spool_bench [--json=path] [--only=parse,stores,maps] [--megabytes=n] [--sizes=n,...]\n"
+        "            [--stores=binary,sqlite] [--uses=n] [--duplication=ratio] [--edits=n] [--seconds=s]\n"
+        "\n"
+        "  --json: Also write the results to a JSON file\n"
+        "  --only: Run only the given benchmarks (all of them by default)\n"
+        "  --megabytes: Size of the sources parsed by the parse benchmarks (8 by default)\n"
+        "  --sizes: Number of strings in the databases of the stores benchmarks (10000,100000,1000000 by default)\n"
+        "  --stores: Backends of those databases (binary,sqlite by default)\n"
+        "  --uses: Uses of SP in each synthesized source (100 by default)\n"
+        "  --duplication: Fraction of those uses that repeat a string used before (0.5 by default)\n"
+        "  --edits: Number of edited sources analyzed into each database (20 by default)\n"
+        "  --seconds: Minimum duration of each throughput measurement (1 by default)\n"
+        "\n");
+}
+
+// Returns the value of --name=value, or nullptr if arg is another option
+static const char* option_value(const char* arg, const char* name)
+{
+    size_t size = std::strlen(name);
+    if (std::strncmp(arg, name, size) != 0 || arg[size] != '=')
+    {
+        return nullptr;
+    }
+    return arg + size + 1;
+}
+
+static std::vector<std::string> split_list(const char* list)
+{
+    std::vector<std::string> out;
+    const char* cursor = list;
+    while (true)
+    {
+        const char* comma = std::strchr(cursor, ',');
+        out.emplace_back(cursor, comma ? comma : cursor + std::strlen(cursor));
+        if (!comma)
+        {
+            return out;
+        }
+        cursor = comma + 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    const char* json_path = nullptr;
+    std::vector<std::string> only = {"parse", "stores", "maps"};
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if ((value = option_value(arg, "--json")))
+        {
+            json_path = value;
+        }
+        else if ((value = option_value(arg, "--only")))
+        {
+            only = split_list(value);
+        }
+        else if ((value = option_value(arg, "--megabytes")))
+        {
+            options.megabytes = std::strtoul(value, nullptr, 10);
+        }
+        else if ((value = option_value(arg, "--sizes")))
+        {
+            options.sizes.clear();
+            for (auto& size : split_list(value))
+            {
+                options.sizes.emplace_back(std::strtoul(size.c_str(), nullptr, 10));
+            }
+        }
+        else if ((value = option_value(arg, "--stores")))
+        {
+            options.stores = split_list(value);
+        }
+        else if ((value = option_value(arg, "--uses")))
+        {
+            options.uses_per_file = std::strtoul(value, nullptr, 10);
+        }
+        else if ((value = option_value(arg, "--duplication")))
+        {
+            options.duplication = std::strtod(value, nullptr);
+        }
+        else if ((value = option_value(arg, "--edits")))
+        {
+            options.edits = std::strtoul(value, nullptr, 10);
+        }
+        else if ((value = option_value(arg, "--seconds")))
+        {
+            options.seconds = std::strtod(value, nullptr);
+        }
+        else
+        {
+            print_help();
+            return std::strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    auto selected = [&](const char* name) {
+        for (auto& entry : only)
+        {
+            if (entry == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    Report report;
+    if (selected("parse"))
+    {
+        bench_parse(report, options);
+    }
+    if (selected("stores"))
+    {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "spool_bench";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        options.directory = directory.string();
+        bench_stores(report, options);
+        std::filesystem::remove_all(directory);
+    }
+    if (selected("maps"))
+    {
+        bench_maps(report, options);
+    }
+
+    if (json_path && !report.write_json(json_path))
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "Benchmarks.hpp"
+#include "Keys.hpp"
+
+#include <spool.h>
+#include <spool_map.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Nanoseconds per operation of `run`, which performs `ops` operations and returns a checksum that keeps them from
+// being optimized away
+template <typename Run> static double ns_per_op(const BenchOptions& options, size_t ops, Run&& run)
+{
+    volatile uint64_t sink = run();
+    size_t total = 0;
+    auto start = Clock::now();
+    std::chrono::duration<double> elapsed{};
+    while (elapsed.count() < options.seconds)
+    {
+        sink = sink + run();
+        total += ops;
+        elapsed = Clock::now() - start;
+    }
+    return elapsed.count() * 1e9 / total;
+}
+
+void bench_maps(Report& report, const BenchOptions& options)
+{
+    // Runtime strings equal to the keys, as they would arrive from parsing or the network
+    std::vector<std::string> strings(bench_keys, bench_keys + bench_key_count);
+
+    std::mt19937 rng{1};
+    std::vector<uint32_t> order(4096);
+    for (auto& index : order)
+    {
+        index = rng() % bench_key_count;
+    }
+
+    std::unordered_map<std::string, uint32_t> by_string;
+    std::unordered_map<const char*, uint32_t> by_pointer;
+    spool::dense_map<uint32_t> by_id;
+    for (uint32_t i = 0; i != bench_key_count; ++i)
+    {
+        by_string.emplace(strings[i], i);
+        by_pointer.emplace(bench_keys[i], i);
+        by_id.try_emplace(spool::id{bench_keys[i]}, i);
+    }
+
+    auto add = [&](const char* name, const char* key, double ns) {
+        report.add({name, {{"key", key}, {"keys", std::to_string(bench_key_count)}}, {{"ns_per_op", ns}}});
+    };
+
+    add("map find", "std::string", ns_per_op(options, order.size(), [&] {
+            uint64_t sum = 0;
+            for (uint32_t index : order)
+            {
+                sum += by_string.find(strings[index])->second;
+            }
+            return sum;
+        }));
+    add("map find", "pooled pointer", ns_per_op(options, order.size(), [&] {
+            uint64_t sum = 0;
+            for (uint32_t index : order)
+            {
+                sum += by_pointer.find(bench_keys[index])->second;
+            }
+            return sum;
+        }));
+    add("map find", "spool::id", ns_per_op(options, order.size(), [&] {
+            uint64_t sum = 0;
+            for (uint32_t index : order)
+            {
+                sum += *by_id.find(spool::id{bench_keys[index]});
+            }
+            return sum;
+        }));
+
+    add("map insert", "std::string", ns_per_op(options, bench_key_count, [&] {
+            std::unordered_map<std::string, uint32_t> map;
+            for (uint32_t i = 0; i != bench_key_count; ++i)
+            {
+                map.emplace(strings[i], i);
+            }
+            return map.size();
+        }));
+    add("map insert", "pooled pointer", ns_per_op(options, bench_key_count, [&] {
+            std::unordered_map<const char*, uint32_t> map;
+            for (uint32_t i = 0; i != bench_key_count; ++i)
+            {
+                map.emplace(bench_keys[i], i);
+            }
+            return map.size();
+        }));
+    add("map insert", "spool::id", ns_per_op(options, bench_key_count, [&] {
+            spool::dense_map<uint32_t> map;
+            for (uint32_t i = 0; i != bench_key_count; ++i)
+            {
+                map.try_emplace(spool::id{bench_keys[i]}, i);
+            }
+            return map.size();
+        }));
+}
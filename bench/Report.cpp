@@ -0,0 +1,89 @@
+#include "Report.hpp"
+
+#include <cstdio>
+
+void Report::add(Measurement measurement)
+{
+    std::printf("%s", measurement.name.c_str());
+    for (size_t i = 0; i != measurement.parameters.size(); ++i)
+    {
+        auto& [key, value] = measurement.parameters[i];
+        std::printf("%s%s=%s", i == 0 ? " (" : ", ", key.c_str(), value.c_str());
+    }
+    std::fputs(measurement.parameters.empty() ? ":" : "):", stdout);
+    for (auto& [key, value] : measurement.metrics)
+    {
+        std::printf(" %s=%.4g", key.c_str(), value);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+
+    measurements_.emplace_back(std::move(measurement));
+}
+
+static void write_string(std::FILE* fp, const std::string& str)
+{
+    std::fputc('"', fp);
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            std::fputc('\\', fp);
+            std::fputc(c, fp);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            std::fprintf(fp, "\\u%04x", c);
+        }
+        else
+        {
+            std::fputc(c, fp);
+        }
+    }
+    std::fputc('"', fp);
+}
+
+bool Report::write_json(const char* path) const
+{
+    std::FILE* fp = std::fopen(path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "Failed to open file for writing: %s", path);
+        return false;
+    }
+
+    std::fprintf(fp, "{\n  \"benchmarks\": [");
+    for (size_t i = 0; i != measurements_.size(); ++i)
+    {
+        const Measurement& measurement = measurements_[i];
+        std::fprintf(fp, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+        write_string(fp, measurement.name);
+
+        std::fprintf(fp, ", \"parameters\": {");
+        for (size_t j = 0; j != measurement.parameters.size(); ++j)
+        {
+            std::fputs(j == 0 ? "" : ", ", fp);
+            write_string(fp, measurement.parameters[j].first);
+            std::fprintf(fp, ": ");
+            write_string(fp, measurement.parameters[j].second);
+        }
+
+        std::fprintf(fp, "}, \"metrics\": {");
+        for (size_t j = 0; j != measurement.metrics.size(); ++j)
+        {
+            std::fputs(j == 0 ? "" : ", ", fp);
+            write_string(fp, measurement.metrics[j].first);
+            std::fprintf(fp, ": %.9g", measurement.metrics[j].second);
+        }
+        std::fprintf(fp, "}}");
+    }
+    std::fprintf(fp, "\n  ]\n}\n");
+
+    bool ok = std::ferror(fp) == 0;
+    ok = std::fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write file: %s", path);
+    }
+    return ok;
+}
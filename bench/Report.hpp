@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// A single benchmark result. The name and parameters identify it across runs, so that results can be compared with
+// those of an earlier build.
+struct Measurement
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> parameters;
+    // Metric names carry their unit (seconds, mib_per_s, ns_per_op, ...)
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+// Collects the measurements of a run, printing each as it is added
+class Report
+{
+public:
+    void add(Measurement measurement);
+
+    // Writes every measurement as {"benchmarks": [{"name", "parameters", "metrics"}, ...]}. Returns false if the file
+    // couldn't be written.
+    bool write_json(const char* path) const;
+
+private:
+    std::vector<Measurement> measurements_;
+};
@@ -0,0 +1,157 @@
+#include "Benchmarks.hpp"
+#include "Synthesize.hpp"
+
+#include "Changes.hpp"
+#include "Generator.hpp"
+#include "Parser.hpp"
+#include "Store.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void bench_parse(Report& report, const BenchOptions& options)
+{
+    for (bool mixed : {false, true})
+    {
+        std::string source = synthesize_source(options.megabytes * 1024 * 1024, mixed);
+        size_t bytes = 0;
+        size_t literals = 0;
+        auto start = Clock::now();
+        double elapsed = 0;
+        while (elapsed < options.seconds)
+        {
+            Parser parser(source.data(), source.size(), "SP");
+            parser.parse();
+            literals += parser.literals().size();
+            bytes += source.size();
+            elapsed = seconds_since(start);
+        }
+
+        double mib = bytes / (1024.0 * 1024.0);
+        report.add({"parse",
+                    {{"forms", mixed ? "mixed" : "plain"}, {"megabytes", std::to_string(options.megabytes)}},
+                    {{"mib_per_s", mib / elapsed}, {"literals_per_s", literals / elapsed}}});
+    }
+}
+
+static std::string format_ratio(double ratio)
+{
+    char out[32];
+    std::snprintf(out, sizeof(out), "%g", ratio);
+    return out;
+}
+
+// Records the literals of a source as `spooler analyze` does
+static void analyze(Changes& changes, int source_id, const std::string& source)
+{
+    Parser parser(source.data(), source.size(), "SP");
+    parser.parse();
+    changes.add(source_id, parser.literals());
+}
+
+static void bench_store(Report& report, const BenchOptions& options, const std::string& kind, size_t size)
+{
+    SourceSpec spec;
+    spec.uses_per_file = options.uses_per_file;
+    spec.duplication = options.duplication;
+    spec.files = 1;
+    size_t new_per_file = SourceSynthesizer{spec}.strings();
+    spec.files = std::max<size_t>(1, size / new_per_file);
+    SourceSynthesizer synthesizer{spec};
+
+    std::filesystem::path path = std::filesystem::path{options.directory} / ("bench_" + std::to_string(size));
+    path += kind == "sqlite" ? ".db" : ".spool";
+    std::filesystem::remove(path);
+
+    std::vector<std::pair<std::string, std::string>> parameters = {
+        {"store", kind},
+        {"strings", std::to_string(synthesizer.strings())},
+        {"uses_per_file", std::to_string(spec.uses_per_file)},
+        {"duplication", format_ratio(spec.duplication)},
+    };
+
+    // Spool the code base in batches, as merges of the targets of a build would
+    std::unique_ptr<Store> store = open_store(path.string().c_str());
+    auto start = Clock::now();
+    constexpr size_t batch_size = 1000;
+    for (size_t first = 0; first < spec.files; first += batch_size)
+    {
+        Changes changes(*store);
+        for (size_t file = first; file != std::min(first + batch_size, spec.files); ++file)
+        {
+            analyze(changes, static_cast<int>(file), synthesizer.source(file));
+        }
+        changes.commit();
+    }
+    double populate = seconds_since(start);
+
+    // Closing the store folds any write-ahead log into the database file
+    store.reset();
+    report.add({"populate",
+                parameters,
+                {{"seconds", populate},
+                 {"strings_per_s", synthesizer.strings() / populate},
+                 {"db_mib", std::filesystem::file_size(path) / (1024.0 * 1024.0)}}});
+
+    // Each spooler process opens the store and reads the source hashes before analyzing anything
+    start = Clock::now();
+    store = open_store(path.string().c_str());
+    store->source_hashes();
+    report.add({"open", parameters, {{"ms", seconds_since(start) * 1e3}}});
+
+    // Edit files spread over the code base and analyze them one at a time, as a compile job of an incremental build
+    double total = 0;
+    double longest = 0;
+    for (size_t edit = 0; edit != options.edits; ++edit)
+    {
+        size_t file = (edit * 7919) % spec.files;
+        std::string source = synthesizer.source(file, static_cast<uint32_t>(edit + 1));
+        start = Clock::now();
+        Changes changes(*store);
+        analyze(changes, static_cast<int>(file), source);
+        changes.commit();
+        double elapsed = seconds_since(start);
+        total += elapsed;
+        longest = std::max(longest, elapsed);
+    }
+    if (options.edits != 0)
+    {
+        report.add({"analyze file",
+                    parameters,
+                    {{"ms_per_file", total * 1e3 / options.edits}, {"max_ms", longest * 1e3}}});
+    }
+
+    start = Clock::now();
+    store->begin_read();
+    Generator generator{*store, GeneratorOptions{}};
+    generator.write_strings();
+    generator.write_source_chunks();
+    generator.write_offsets();
+    store->end_read();
+    double generate = seconds_since(start);
+    report.add({"generate",
+                parameters,
+                {{"seconds", generate}, {"output_mib", generator.output().size() / (1024.0 * 1024.0)}}});
+}
+
+void bench_stores(Report& report, const BenchOptions& options)
+{
+    for (auto& kind : options.stores)
+    {
+        for (size_t size : options.sizes)
+        {
+            bench_store(report, options, kind, size);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include "Synthesize.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Lines of plain C++-like source, about one in eight using the spool macro
+static const char* plain_lines[] = {
+    "    int result = compute_value(first_argument, second_argument) + Some_Type::constant;\n",
+    "    const char* name = SP(\"component.name.%u\");\n",
+    "    // Comments mention SPOOLED things and \"quoted\" things\n",
+    "    printf(\"A regular literal with \\\"escapes\\\" and a number %%d\\n\", value);\n",
+    "    for (size_t index = 0; index != container.size(); ++index) { total += container[index]; }\n",
+    "    registry.insert(SP(\"system.\" \"subsystem.%u\"), handler_for(Kind::Strong));\n",
+    "    if (lhs.identifier == rhs.identifier && lhs.version >= minimum_version) return true;\n",
+    "    std::string message = \"Unexpected state encountered while processing the request\";\n",
+};
+
+// Lines using the literal forms that need more than a quote scan: comments, character literals, digit separators, raw
+// strings and prefixes
+static const char* mixed_lines[] = {
+    "    int result = compute_value(first_argument, 1'000'000) + Some_Type::constant; // \"quoted\" comment\n",
+    "    const char* name = SP(u8\"component.name.%u\");\n",
+    "    /* Comments mention SPOOLED things and \"quoted\" things, don't they */\n",
+    "    if (c == '\"' || c == '\\'') { printf(\"A regular literal with \\\"escapes\\\" and %%d\\n\", value); }\n",
+    "    const char* json = R\"json({\"key\": \"value\", \"other\": [1, 2, 3]})json\";\n",
+    "    registry.insert(SP(\"system.\" R\"(subsystem.%u)\"), handler_for(Kind::Strong));\n",
+    "    if (lhs.identifier == rhs.identifier && lhs.version >= minimum_version) return true;\n",
+    "    std::string message = \"Unexpected state encountered while processing the request\";\n",
+};
+
+// Ordinary code placed between the uses of a synthesized file
+static const char* filler_lines[] = {
+    "    int result = compute_value(first_argument, second_argument) + Some_Type::constant;\n",
+    "    // Comments mention SPOOLED things and \"quoted\" things\n",
+    "    for (size_t index = 0; index != container.size(); ++index) { total += container[index]; }\n",
+    "    if (lhs.identifier == rhs.identifier && lhs.version >= minimum_version) return true;\n",
+};
+
+// Spellings of the synthesized strings, which vary in length like real ones
+static const char* string_formats[] = {
+    "component.%llu.name",
+    "system.%llu",
+    "ui.panel.%llu.label.text",
+    "Failed to load the resource %llu, falling back to the default",
+};
+
+SourceSynthesizer::SourceSynthesizer(const SourceSpec& spec)
+    : spec_{spec}
+    , new_per_file_{std::max<size_t>(1, static_cast<size_t>(spec.uses_per_file * (1.0 - spec.duplication) + 0.5))}
+{
+    new_per_file_ = std::min(new_per_file_, spec.uses_per_file);
+}
+
+std::string SourceSynthesizer::source(size_t file, uint32_t revision) const
+{
+    std::mt19937_64 rng{spec_.seed * 0x9e3779b97f4a7c15ull + file};
+
+    // The first uses introduce the strings of this file, and the others repeat any string introduced so far
+    size_t first_new = file * new_per_file_;
+    std::vector<uint64_t> ids(spec_.uses_per_file);
+    for (size_t i = 0; i != ids.size(); ++i)
+    {
+        ids[i] = i < new_per_file_ ? first_new + i : rng() % (first_new + new_per_file_);
+    }
+    std::shuffle(ids.begin(), ids.end(), rng);
+
+    std::string out = "// Synthesized by spool_bench\n\nvoid register_all(Registry& registry)\n{\n";
+    char line[256];
+    for (size_t i = 0; i != ids.size(); ++i)
+    {
+        uint64_t id = ids[i];
+        const char* format = string_formats[id % (sizeof(string_formats) / sizeof(*string_formats))];
+        char str[128];
+        std::snprintf(str, sizeof(str), format, static_cast<unsigned long long>(id));
+        if (revision != 0 && id == first_new)
+        {
+            size_t size = std::strlen(str);
+            std::snprintf(str + size, sizeof(str) - size, " (revision %u)", revision);
+        }
+
+        std::snprintf(line, sizeof(line), "    registry.insert(SP(\"%s\"), handler_for(Kind::Strong));\n", str);
+        out += line;
+        out += filler_lines[i % (sizeof(filler_lines) / sizeof(*filler_lines))];
+    }
+    out += "}\n";
+    return out;
+}
+
+std::string synthesize_source(size_t size, bool mixed)
+{
+    const char** lines = mixed ? mixed_lines : plain_lines;
+    constexpr size_t line_count = sizeof(plain_lines) / sizeof(*plain_lines);
+    static_assert(line_count == sizeof(mixed_lines) / sizeof(*mixed_lines));
+
+    std::string out;
+    out.reserve(size + 128);
+    char line[256];
+    unsigned i = 0;
+    while (out.size() < size)
+    {
+        std::snprintf(line, sizeof(line), lines[i % line_count], i % 4096);
+        out += line;
+        ++i;
+    }
+    return out;
+}
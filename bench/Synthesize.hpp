@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of a synthetic code base spooled by the benchmarks
+struct SourceSpec
+{
+    size_t files = 100;
+    size_t uses_per_file = 100;
+    // Fraction of the uses of each file that repeat a string used before (by the file or an earlier one) instead of
+    // introducing a new one
+    double duplication = 0.5;
+    uint64_t seed = 1;
+};
+
+// Produces the sources of a synthetic code base one file at a time, so code bases of any size can be spooled without
+// holding them in memory. The same file and revision always produce the same source.
+class SourceSynthesizer
+{
+public:
+    explicit SourceSynthesizer(const SourceSpec& spec);
+
+    // Uses of SP interleaved with ordinary code. Each later revision of a file replaces one of the strings it
+    // introduced with a new one, as an edit would.
+    [[nodiscard]] std::string source(size_t file, uint32_t revision = 0) const;
+
+    // Number of distinct strings used by every file at its first revision
+    [[nodiscard]] size_t strings() const noexcept
+    {
+        return spec_.files * new_per_file_;
+    }
+
+    [[nodiscard]] const SourceSpec& spec() const noexcept
+    {
+        return spec_;
+    }
+
+private:
+    SourceSpec spec_;
+    size_t new_per_file_;
+};
+
+// Roughly `size` bytes of source with about one use of SP in eight lines, in plain literals only or (if mixed) along
+// with comments, character literals, digit separators, raw strings and prefixes
+std::string synthesize_source(size_t size, bool mixed);
@@ -0,0 +1,28 @@
+#include "Lookups.hpp"
+
+#include <atomic>
+#include <spool.h>
+
+uint64_t library_lookups(size_t count)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i != count; ++i)
+    {
+        const char* str = nullptr;
+        switch (i & 7)
+        {
+        case 0: str = SP("alpha"); break;
+        case 1: str = SP("bravo"); break;
+        case 2: str = SP("charlie"); break;
+        case 3: str = SP("delta"); break;
+        case 4: str = SP("echo"); break;
+        case 5: str = SP("foxtrot"); break;
+        case 6: str = SP("golf"); break;
+        default: str = SP("hotel"); break;
+        }
+        total += spool_len(str);
+        // Keep the compiler from hoisting the table loads out of the loop
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    return total;
+}
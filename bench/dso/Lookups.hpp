@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sums the lengths of the strings produced by `count` uses of SP, spread over eight uses with distinct strings. The
+// tables are read again for every use. Each is defined in a library and again in the executable, so the costs of
+// reaching the tables from either can be compared.
+uint64_t library_lookups(size_t count);
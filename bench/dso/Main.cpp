@@ -0,0 +1,61 @@
+// Cost of reaching the spool tables from the executable and from a library. Built once against a static spool and
+// once against a shared spool (SPOOL_SHARED), whose tables other modules reach through their global offset table. Run
+// `spool_bench_dso [million lookups]` from a release build.
+
+#include "Lookups.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <spool.h>
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t executable_lookups(size_t count)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i != count; ++i)
+    {
+        const char* str = nullptr;
+        switch (i & 7)
+        {
+        case 0: str = SP("alpha"); break;
+        case 1: str = SP("bravo"); break;
+        case 2: str = SP("charlie"); break;
+        case 3: str = SP("delta"); break;
+        case 4: str = SP("echo"); break;
+        case 5: str = SP("foxtrot"); break;
+        case 6: str = SP("golf"); break;
+        default: str = SP("hotel"); break;
+        }
+        total += spool_len(str);
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+    return total;
+}
+
+template <typename Lookups> void bench_lookups(const char* name, size_t count, Lookups&& lookups)
+{
+    // Warm up the caches and the lazy binding of the library
+    uint64_t total = lookups(count / 16);
+    auto start = Clock::now();
+    total += lookups(count);
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::printf("%s: %.3f ns per lookup (checksum %llu)\n", name, elapsed.count() * 1e9 / count,
+                static_cast<unsigned long long>(total));
+}
+
+int main(int argc, char** argv)
+{
+    size_t millions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+#ifdef SPOOL_SHARED
+    const char* spool = "shared spool";
+#else
+    const char* spool = "static spool";
+#endif
+    std::printf("%s\n", spool);
+    bench_lookups("  from the executable", millions * 1000000, executable_lookups);
+    bench_lookups("  from a library", millions * 1000000, library_lookups);
+    return 0;
+}
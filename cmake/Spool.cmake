@@ -1,133 +1,323 @@
 set(SPOOL_PROJECT_DIR ${CMAKE_CURRENT_LIST_DIR}/..)
 set(SPOOL_MACRO "SP")
 
-function(spool_file TARG TARG_SOURCE)
-    if (ARGV2)
-        set(SPOOL ${ARGV2})
+# File holding the database of a spool. The extension selects the storage backend (see spooler/Store.hpp), which is
+# fixed when the spool is created.
+function(spool_database_file SPOOL OUT)
+    if (SPOOL_STORE STREQUAL "sqlite")
+        set(${OUT} ${SPOOL}.db PARENT_SCOPE)
     else()
-        set(SPOOL default_spool)
+        set(${OUT} ${SPOOL}.spool PARENT_SCOPE)
+    endif()
+endfunction()
+
+# Command that runs the spooler for SPOOL. With SPOOL_STATS, every command appends the time spent in each of its phases
+# to a trace of the spool, which Chrome's about:tracing or Perfetto open.
+function(spool_spooler_command SPOOL OUT)
+    if (SPOOL_STATS)
+        set(${OUT} ${CMAKE_COMMAND} -E env SPOOLER_STATS=${CMAKE_BINARY_DIR}/spool/${SPOOL}.trace.json
+            $<TARGET_FILE:spooler> PARENT_SCOPE)
+    else()
+        set(${OUT} $<TARGET_FILE:spooler> PARENT_SCOPE)
     endif()
+endfunction()
+
+# Creates the library, database and generation step for a spool domain the first time the domain is referenced
+function(spool_domain SPOOL)
     set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
     set(SPOOL_TMP ${SPOOL}_TMP)
-    set(SPOOL_DB ${SPOOL_DIR}/${SPOOL}.db)
     set(SPOOL_SOURCE ${SPOOL_DIR}/${SPOOL}.cpp)
-    if (NOT TARGET ${SPOOL})
-        define_property(TARGET PROPERTY SPOOL_FILE_COUNTER
-            BRIEF_DOCS "Spool file counter"
-            FULL_DOCS "This is tracked per spool to assign unique ids to each source file")
-
-        # Initialize SQLite database
+    if (TARGET ${SPOOL})
+        return()
+    endif()
 
-        add_custom_command(
-            OUTPUT ${SPOOL_DB}
-            COMMAND sqlite3 ${SPOOL}.db ".read ${SPOOL_PROJECT_DIR}/sql/spool.sql"
-            WORKING_DIRECTORY ${SPOOL_DIR}
-            COMMENT "Initializing database for spool ${SPOOL}: ${SPOOL_DB}"
-            )
+    define_property(TARGET PROPERTY SPOOL_FILE_COUNTER
+        BRIEF_DOCS "Spool file counter"
+        FULL_DOCS "This is tracked per spool to assign unique ids to each source file")
+    define_property(TARGET PROPERTY SPOOL_LAST_SENTINEL
+        BRIEF_DOCS "Most recent spool sentinel"
+        FULL_DOCS "Analysis steps within a spool are chained through their sentinels so the database has one writer")
+    define_property(TARGET PROPERTY SPOOL_DATABASE
+        BRIEF_DOCS "Spool database file"
+        FULL_DOCS "Path of the spool database relative to the spool directory, created by the spooler on first use")
+    define_property(TARGET PROPERTY SPOOL_HEADERS
+        BRIEF_DOCS "Spooled headers"
+        FULL_DOCS "Source id and path of each header in a spool, analyzed when the spool is generated by the launcher")
 
-        file(MAKE_DIRECTORY ${SPOOL_DIR})
+    file(MAKE_DIRECTORY ${SPOOL_DIR})
+    # Touching an existing source would recompile the spool on every reconfigure
+    if (NOT EXISTS ${SPOOL_SOURCE})
         file(TOUCH ${SPOOL_SOURCE})
-        file(MAKE_DIRECTORY ${SPOOL_DIR}/${SPOOL_TMP})
+    endif()
+    file(MAKE_DIRECTORY ${SPOOL_DIR}/${SPOOL_TMP})
 
+    if (SPOOL_SHARED)
+        # Shared libraries and executables that each linked a static spool would each hold their own copy of the
+        # tables, so equal strings from different modules would no longer share a pointer. A shared spool defines the
+        # tables once and exports nothing else.
+        add_library(${SPOOL} SHARED ${SPOOL_SOURCE})
+        set_target_properties(${SPOOL} PROPERTIES CXX_VISIBILITY_PRESET hidden VISIBILITY_INLINES_HIDDEN ON)
+        target_compile_definitions(${SPOOL} PUBLIC SPOOL_SHARED)
+    else()
         add_library(${SPOOL} ${SPOOL_SOURCE})
-        set_target_properties(${SPOOL} PROPERTIES SPOOL_FILE_COUNTER 0)
+    endif()
+    spool_database_file(${SPOOL} SPOOL_DB)
+    set_target_properties(${SPOOL} PROPERTIES
+        SPOOL_FILE_COUNTER 0 SPOOL_LAST_SENTINEL "" SPOOL_DATABASE ${SPOOL_DB} SPOOL_HEADERS "")
+
+    # The table layout is fixed when the spool is created, and must be known to spool.h in every spooled source
+    set(SPOOL_GENERATE_FLAGS "")
+    if (SPOOL_OFFSET_TABLES)
+        list(APPEND SPOOL_GENERATE_FLAGS --offsets)
+        target_compile_definitions(${SPOOL} INTERFACE SPOOL_OFFSET_TABLES)
+    endif()
+    if (SPOOL_TAIL_MERGING)
+        list(APPEND SPOOL_GENERATE_FLAGS --tail-merge)
+        target_compile_definitions(${SPOOL} INTERFACE SPOOL_TAIL_MERGING)
+    endif()
+    if (SPOOL_ORDER AND NOT SPOOL_ORDER STREQUAL "refs")
+        list(APPEND SPOOL_GENERATE_FLAGS --order=${SPOOL_ORDER})
+    endif()
+    if (NOT SPOOL_COMPACT_RATIO STREQUAL "")
+        list(APPEND SPOOL_GENERATE_FLAGS --compact-above=${SPOOL_COMPACT_RATIO})
+    endif()
+
+    spool_spooler_command(${SPOOL} SPOOLER)
 
+    # A profile is imported into the database whenever it changes, and the spool regenerated with it
+    set(SPOOL_PROFILE_COMMAND "")
+    if (SPOOL_ORDER STREQUAL "profile" AND SPOOL_PROFILE_DATA)
+        if (SPOOL_COMPILER_LAUNCHER)
+            message(FATAL_ERROR "SPOOL_PROFILE_DATA requires SPOOL_COMPILER_LAUNCHER to be off. Import profiles into "
+                "the spool database with `spooler profile` instead.")
+        endif()
+        set(SPOOL_PROFILE_COMMAND COMMAND ${SPOOLER} profile ${SPOOL_DB} ${SPOOL_PROFILE_DATA})
+    endif()
+
+    if (SPOOL_COMPILER_LAUNCHER)
+        if (NOT CMAKE_GENERATOR MATCHES "Ninja" OR CMAKE_VERSION VERSION_LESS 3.20)
+            message(FATAL_ERROR "SPOOL_COMPILER_LAUNCHER requires a Ninja generator and CMake 3.20 or newer")
+        endif()
+        # The compile job of the spool source generates it first. Every spooled object is added to its dependencies by
+        # spool_launch.
+        set(LAUNCHER ${SPOOLER} cc ${SPOOL_DIR}/${SPOOL_DB} --generate ${SPOOL_GENERATE_FLAGS})
+        set_target_properties(${SPOOL} PROPERTIES CXX_COMPILER_LAUNCHER "${LAUNCHER}")
+        # Headers are only known once every target has been spooled. Deferred arguments are expanded when the call
+        # runs, in the top level directory, so they are substituted now.
+        cmake_language(EVAL CODE "cmake_language(DEFER DIRECTORY [[${CMAKE_SOURCE_DIR}]] \
+            CALL spool_launch_headers [[${SPOOL}]] [[${SPOOL_MACRO}]])")
+    else()
+        # Every analysis step appends its sentinel to the dependencies of this command. The spooler leaves the source
+        # untouched when its contents wouldn't change.
         add_custom_command(
             OUTPUT ${SPOOL_SOURCE}
-            COMMAND $<TARGET_FILE:spooler> generate ${SPOOL}.db ${SPOOL}.cpp
+            ${SPOOL_PROFILE_COMMAND}
+            COMMAND ${SPOOLER} generate ${SPOOL_DB} ${SPOOL}.cpp ${SPOOL_GENERATE_FLAGS}
             WORKING_DIRECTORY ${SPOOL_DIR}
-            DEPENDS ${SPOOL_DB}
-            COMMENT "Populating ${SPOOL}.cpp with data from ${SPOOL}.db"
+            DEPENDS spooler ${SPOOL_PROFILE_DATA}
+            COMMENT "Populating ${SPOOL}.cpp with data from ${SPOOL_DB}"
             )
-        add_dependencies(${SPOOL} spooler)
     endif()
+    add_dependencies(${SPOOL} spooler)
+endfunction()
 
-    target_link_libraries(${TARG} PUBLIC ${SPOOL} spool)
-    get_target_property(TARG_SOURCE_DIR ${TARG} SOURCE_DIR)
-    get_target_property(SPOOL_FILE_ID ${SPOOL} SPOOL_FILE_COUNTER)
-
-    # Add a monotonically increasing compile definition for each source file in a spool
-    set_source_files_properties(${TARG_SOURCE}
-        PROPERTIES COMPILE_DEFINITIONS SPOOL_ID=${SPOOL_FILE_ID})
+# Links the spool library into TARG
+function(spool_link SPOOL TARG)
+    if (SPOOL_COMPILER_LAUNCHER)
+        # Linking the library as a file keeps the objects of TARG from waiting for the spool, whose source is compiled
+        # after them, while the link step still waits for it
+        target_link_libraries(${TARG} PUBLIC $<TARGET_LINKER_FILE:${SPOOL}> spool)
+        target_compile_definitions(${TARG} PUBLIC $<TARGET_PROPERTY:${SPOOL},INTERFACE_COMPILE_DEFINITIONS>)
+        set_property(TARGET ${TARG} APPEND PROPERTY LINK_DEPENDS $<TARGET_LINKER_FILE:${SPOOL}>)
+    else()
+        target_link_libraries(${TARG} PUBLIC ${SPOOL} spool)
+    endif()
+endfunction()
 
-    message("Adding ${TARG_SOURCE} to spool ${SPOOL} (id: ${SPOOL_FILE_ID})")
+# Spools the sources of TARG that define SPOOL_ID within their compile jobs, through spooler cc as the compiler
+# launcher. Each compile job analyzes its source into the spool database, and the spool source is compiled (and so
+# generated) only once every spooled object is up to date. This needs file level dependencies between targets, which
+# only the Ninja generators provide.
+function(spool_launch SPOOL TARG)
+    define_property(TARGET PROPERTY SPOOL_LAUNCHED
+        BRIEF_DOCS "Spool of a launched target"
+        FULL_DOCS "The spool that the compiler launcher of a target analyzes its sources into")
+    get_target_property(LAUNCHED ${TARG} SPOOL_LAUNCHED)
+    if (LAUNCHED STREQUAL SPOOL)
+        return()
+    elseif (LAUNCHED)
+        message(FATAL_ERROR "With SPOOL_COMPILER_LAUNCHER, all sources of ${TARG} must use the same spool")
+    endif()
 
-    set(SPOOL_SENTINEL ${SPOOL_TMP}/${SPOOL}_${SPOOL_FILE_ID})
+    set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
+    set(SPOOL_SOURCE ${SPOOL_DIR}/${SPOOL}.cpp)
+    get_target_property(SPOOL_DB ${SPOOL} SPOOL_DATABASE)
 
-    if (SPOOL_FILE_ID GREATER 0)
-        # TODO DB access is not transactional yet, so files are parsed one at a time
-        math(EXPR LAST_FILE_ID "${SPOOL_FILE_ID} - 1")
-        set(LAST_SENTINEL ${SPOOL_DIR}/${SPOOL_TMP}/${SPOOL}_${LAST_FILE_ID})
+    # Keep any launcher already in place (such as ccache) in front of the compiler
+    spool_spooler_command(${SPOOL} SPOOLER)
+    set(LAUNCHER ${SPOOLER} cc ${SPOOL_DIR}/${SPOOL_DB} ${SPOOL_MACRO})
+    get_target_property(EXISTING_LAUNCHER ${TARG} CXX_COMPILER_LAUNCHER)
+    if (EXISTING_LAUNCHER)
+        list(APPEND LAUNCHER ${EXISTING_LAUNCHER})
     endif()
+    set_target_properties(${TARG} PROPERTIES SPOOL_LAUNCHED ${SPOOL} CXX_COMPILER_LAUNCHER "${LAUNCHER}")
+    add_dependencies(${TARG} spooler)
 
-    # Parse source file for spool-designated strings and extract them into the spool database
+    # OBJECT_DEPENDS doesn't take generator expressions, so the spool source depends on the objects through a stamp
+    set(SPOOL_OBJECTS_STAMP ${SPOOL_DIR}/${SPOOL}_TMP/${TARG}.objects)
     add_custom_command(
-        OUTPUT ${SPOOL_DIR}/${SPOOL_SENTINEL}
-        COMMAND ${CMAKE_COMMAND} -E touch ${SPOOL_SENTINEL}
-        COMMAND $<TARGET_FILE:spooler> analyze ${SPOOL}.db ${TARG_SOURCE_DIR}/${TARG_SOURCE} ${SPOOL_MACRO} ${SPOOL_FILE_ID}
-        WORKING_DIRECTORY ${SPOOL_DIR}
-        DEPENDS ${TARG_SOURCE_DIR}/${TARG_SOURCE} spooler ${LAST_SENTINEL}
-        COMMENT "Running spooler on ${TARG_SOURCE}"
+        OUTPUT ${SPOOL_OBJECTS_STAMP}
+        COMMAND ${CMAKE_COMMAND} -E touch ${SPOOL_OBJECTS_STAMP}
+        DEPENDS $<TARGET_OBJECTS:${TARG}>
         )
+    set_property(SOURCE ${SPOOL_SOURCE} TARGET_DIRECTORY ${SPOOL} APPEND PROPERTY OBJECT_DEPENDS ${SPOOL_OBJECTS_STAMP})
+endfunction()
 
-    get_source_file_property(SPOOL_DEPS ${SPOOL_SOURCE} OBJECT_DEPENDS)
-    if (SPOOL_DEPS STREQUAL "NOTFOUND")
-        set(SPOOL_DEPS ${SPOOL_DIR}/${SPOOL_SENTINEL})
+# True if SOURCE is a header, which is never compiled by itself
+function(spool_is_header SOURCE OUT)
+    if (SOURCE MATCHES "\\.(h|hh|hpp|hxx|inl|ipp)$")
+        set(${OUT} TRUE PARENT_SCOPE)
     else()
-        list(APPEND SPOOL_DEPS ${SPOOL_DIR}/${SPOOL_SENTINEL})
+        set(${OUT} FALSE PARENT_SCOPE)
     endif()
-    set_source_files_properties(${SPOOL_SOURCE} PROPERTIES OBJECT_DEPENDS "${SPOOL_DEPS}")
+endfunction()
 
-    MATH(EXPR SPOOL_FILE_ID "${SPOOL_FILE_ID} + 1")
+# Headers spooled with the compiler launcher are analyzed by the compile job of the spool source instead, which is
+# rerun whenever one of them changes
+function(spool_launch_headers SPOOL MACRO)
+    get_target_property(SPOOL_HEADERS ${SPOOL} SPOOL_HEADERS)
+    if (NOT SPOOL_HEADERS)
+        return()
+    endif()
+
+    set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
+    set(SPOOL_SOURCE ${SPOOL_DIR}/${SPOOL}.cpp)
+    set(SPOOL_LIST_CONTENTS "")
+    set(SPOOL_HEADER_FILES "")
+    foreach(ENTRY ${SPOOL_HEADERS})
+        string(REPLACE "|" " " LINE ${ENTRY})
+        string(APPEND SPOOL_LIST_CONTENTS "${LINE}\n")
+        string(REGEX REPLACE "^[0-9]+\\|" "" HEADER ${ENTRY})
+        list(APPEND SPOOL_HEADER_FILES ${HEADER})
+    endforeach()
+
+    # Only touch the list when its contents change so reconfiguring doesn't force a rebuild
+    set(SPOOL_LIST ${SPOOL_DIR}/${SPOOL}_TMP/headers.list)
+    file(WRITE ${SPOOL_LIST}.tmp ${SPOOL_LIST_CONTENTS})
+    configure_file(${SPOOL_LIST}.tmp ${SPOOL_LIST} COPYONLY)
+
+    get_target_property(LAUNCHER ${SPOOL} CXX_COMPILER_LAUNCHER)
+    list(APPEND LAUNCHER --headers=${SPOOL_LIST} --macro=${MACRO})
+    set_target_properties(${SPOOL} PROPERTIES CXX_COMPILER_LAUNCHER "${LAUNCHER}")
+    set_property(SOURCE ${SPOOL_SOURCE} TARGET_DIRECTORY ${SPOOL} APPEND PROPERTY
+        OBJECT_DEPENDS ${SPOOL_HEADER_FILES})
 endfunction()
 
-function(spool TARG)
-    if (ARGV1)
-        set(SPOOL ${ARGV1})
+# Parses a single source into its own literal file. Parse steps never touch the database, so they run in parallel. The
+# literal file is only rewritten when the literals of the source changed.
+function(spool_parse SPOOL SOURCE SOURCE_ID)
+    set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
+    set(SPOOL_TMP ${SPOOL}_TMP)
+    set(SPOOL_LITERALS ${SPOOL_DIR}/${SPOOL_TMP}/${SPOOL}_${SOURCE_ID}.lits)
+    spool_spooler_command(${SPOOL} SPOOLER)
+
+    add_custom_command(
+        OUTPUT ${SPOOL_LITERALS}
+        COMMAND ${SPOOLER} parse ${SOURCE} ${SPOOL_MACRO} ${SPOOL_LITERALS}
+        WORKING_DIRECTORY ${SPOOL_DIR}
+        DEPENDS ${SOURCE} spooler
+        COMMENT "Running spooler on ${SOURCE}"
+        )
+endfunction()
+
+# Merges the literal files listed in LIST_CONTENTS into the spool database. Merges are the only steps that write the
+# database, and are chained within a spool so there is a single writer at a time. The spooler only touches the sentinel
+# when the database changed, so unchanged literals don't regenerate the spool.
+function(spool_merge SPOOL NAME LIST_CONTENTS)
+    set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
+    set(SPOOL_TMP ${SPOOL}_TMP)
+    set(SPOOL_SOURCE ${SPOOL_DIR}/${SPOOL}.cpp)
+    get_target_property(LAST_SENTINEL ${SPOOL} SPOOL_LAST_SENTINEL)
+    get_target_property(SPOOL_DB ${SPOOL} SPOOL_DATABASE)
+
+    # Only touch the list when its contents change so reconfiguring doesn't force a rebuild
+    set(SPOOL_LIST ${SPOOL_DIR}/${SPOOL_TMP}/${NAME}.list)
+    file(WRITE ${SPOOL_LIST}.tmp ${LIST_CONTENTS})
+    configure_file(${SPOOL_LIST}.tmp ${SPOOL_LIST} COPYONLY)
+
+    set(SPOOL_SENTINEL ${SPOOL_DIR}/${SPOOL_TMP}/${NAME}.merge)
+    spool_spooler_command(${SPOOL} SPOOLER)
+
+    add_custom_command(
+        OUTPUT ${SPOOL_SENTINEL}
+        COMMAND ${SPOOLER} merge ${SPOOL_DB} ${SPOOL_LIST} ${SPOOL_SENTINEL}
+        WORKING_DIRECTORY ${SPOOL_DIR}
+        DEPENDS ${ARGN} ${SPOOL_LIST} spooler ${LAST_SENTINEL}
+        COMMENT "Merging ${NAME} into spool ${SPOOL}"
+        )
+    add_custom_command(OUTPUT ${SPOOL_SOURCE} APPEND DEPENDS ${SPOOL_SENTINEL})
+
+    set_target_properties(${SPOOL} PROPERTIES SPOOL_LAST_SENTINEL ${SPOOL_SENTINEL})
+endfunction()
+
+function(spool_file TARG TARG_SOURCE)
+    if (ARGV2)
+        set(SPOOL ${ARGV2})
     else()
         set(SPOOL default_spool)
     endif()
     set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
     set(SPOOL_TMP ${SPOOL}_TMP)
-    set(SPOOL_DB ${SPOOL_DIR}/${SPOOL}.db)
-    set(SPOOL_SOURCE ${SPOOL_DIR}/${SPOOL}.cpp)
-    if (NOT TARGET ${SPOOL})
-        define_property(TARGET PROPERTY SPOOL_FILE_COUNTER
-            BRIEF_DOCS "Spool file counter"
-            FULL_DOCS "This is tracked per spool to assign unique ids to each source file")
+    spool_domain(${SPOOL})
 
-        # Initialize SQLite database
+    spool_link(${SPOOL} ${TARG})
+    get_target_property(TARG_SOURCE_DIR ${TARG} SOURCE_DIR)
+    get_target_property(SPOOL_FILE_ID ${SPOOL} SPOOL_FILE_COUNTER)
 
-        add_custom_command(
-            OUTPUT ${SPOOL_DB}
-            COMMAND sqlite3 ${SPOOL}.db ".read ${SPOOL_PROJECT_DIR}/sql/spool.sql"
-            WORKING_DIRECTORY ${SPOOL_DIR}
-            COMMENT "Initializing database for spool ${SPOOL}: ${SPOOL_DB}"
-            )
+    # Add a monotonically increasing compile definition for each source file in a spool
+    set_source_files_properties(${TARG_SOURCE}
+        PROPERTIES COMPILE_DEFINITIONS SPOOL_ID=${SPOOL_FILE_ID})
 
-        file(MAKE_DIRECTORY ${SPOOL_DIR})
-        file(TOUCH ${SPOOL_SOURCE})
-        file(MAKE_DIRECTORY ${SPOOL_DIR}/${SPOOL_TMP})
+    message("Adding ${TARG_SOURCE} to spool ${SPOOL} (id: ${SPOOL_FILE_ID})")
 
-        add_library(${SPOOL} ${SPOOL_SOURCE})
-        set_target_properties(${SPOOL} PROPERTIES SPOOL_FILE_COUNTER 0)
+    # Parse source file for spool-designated strings and extract them into the spool database
+    if (SPOOL_COMPILER_LAUNCHER)
+        spool_launch(${SPOOL} ${TARG})
+        spool_is_header(${TARG_SOURCE} IS_HEADER)
+        if (IS_HEADER)
+            set_property(TARGET ${SPOOL} APPEND PROPERTY
+                SPOOL_HEADERS "${SPOOL_FILE_ID}|${TARG_SOURCE_DIR}/${TARG_SOURCE}")
+        endif()
+    else()
+        set(SPOOL_LITERALS ${SPOOL_DIR}/${SPOOL_TMP}/${SPOOL}_${SPOOL_FILE_ID}.lits)
+        spool_parse(${SPOOL} ${TARG_SOURCE_DIR}/${TARG_SOURCE} ${SPOOL_FILE_ID})
+        spool_merge(${SPOOL} ${SPOOL}_${SPOOL_FILE_ID} "${SPOOL_FILE_ID} ${SPOOL_LITERALS}\n" ${SPOOL_LITERALS})
+    endif()
 
-        add_custom_command(
-            OUTPUT ${SPOOL_SOURCE}
-            COMMAND $<TARGET_FILE:spooler> generate ${SPOOL}.db ${SPOOL}.cpp
-            WORKING_DIRECTORY ${SPOOL_DIR}
-            DEPENDS ${SPOOL_DB}
-            COMMENT "Populating ${SPOOL}.cpp with data from ${SPOOL}.db"
-            )
-        add_dependencies(${SPOOL} spooler)
+    MATH(EXPR SPOOL_FILE_ID "${SPOOL_FILE_ID} + 1")
+    set_target_properties(${SPOOL} PROPERTIES SPOOL_FILE_COUNTER ${SPOOL_FILE_ID})
+endfunction()
+
+function(spool TARG)
+    if (ARGV1)
+        set(SPOOL ${ARGV1})
+    else()
+        set(SPOOL default_spool)
     endif()
+    set(SPOOL_DIR ${CMAKE_BINARY_DIR}/spool)
+    set(SPOOL_TMP ${SPOOL}_TMP)
+    spool_domain(${SPOOL})
 
-    target_link_libraries(${TARG} PUBLIC ${SPOOL} spool)
+    spool_link(${SPOOL} ${TARG})
     get_target_property(TARG_SOURCES ${TARG} SOURCES)
     get_target_property(TARG_SOURCE_DIR ${TARG} SOURCE_DIR)
 
     get_target_property(SPOOL_FILE_ID ${SPOOL} SPOOL_FILE_COUNTER)
 
+    # Each line of the list holds a source id and the literal file its source is parsed into
+    set(SPOOL_LIST_CONTENTS "")
+    set(SPOOL_LITERAL_FILES "")
+
     foreach(TARG_SOURCE ${TARG_SOURCES})
         # Add a monotonically increasing compile definition for each source file in a spool
         set_source_files_properties(${TARG_SOURCE_DIR}/${TARG_SOURCE}
@@ -135,34 +325,26 @@ function(spool TARG)
 
         message("Adding ${TARG_SOURCE} to spool ${SPOOL} (id: ${SPOOL_FILE_ID})")
 
-        set(SPOOL_SENTINEL ${SPOOL_TMP}/${SPOOL}_${SPOOL_FILE_ID})
-
-        if (SPOOL_FILE_ID GREATER 0)
-            # TODO DB access is not transactional yet, so files are parsed one at a time
-            math(EXPR LAST_FILE_ID "${SPOOL_FILE_ID} - 1")
-            set(LAST_SENTINEL ${SPOOL_DIR}/${SPOOL_TMP}/${SPOOL}_${LAST_FILE_ID})
+        spool_is_header(${TARG_SOURCE} IS_HEADER)
+        if (SPOOL_COMPILER_LAUNCHER AND IS_HEADER)
+            set_property(TARGET ${SPOOL} APPEND PROPERTY
+                SPOOL_HEADERS "${SPOOL_FILE_ID}|${TARG_SOURCE_DIR}/${TARG_SOURCE}")
+        elseif (NOT SPOOL_COMPILER_LAUNCHER)
+            set(SPOOL_LITERALS ${SPOOL_DIR}/${SPOOL_TMP}/${SPOOL}_${SPOOL_FILE_ID}.lits)
+            spool_parse(${SPOOL} ${TARG_SOURCE_DIR}/${TARG_SOURCE} ${SPOOL_FILE_ID})
+            string(APPEND SPOOL_LIST_CONTENTS "${SPOOL_FILE_ID} ${SPOOL_LITERALS}\n")
+            list(APPEND SPOOL_LITERAL_FILES ${SPOOL_LITERALS})
         endif()
 
-        # Parse source file for spool-designated strings and extract them into the spool database
-        add_custom_command(
-            OUTPUT ${SPOOL_DIR}/${SPOOL_SENTINEL}
-            COMMAND ${CMAKE_COMMAND} -E touch ${SPOOL_SENTINEL}
-            COMMAND $<TARGET_FILE:spooler> analyze ${SPOOL}.db ${TARG_SOURCE_DIR}/${TARG_SOURCE} ${SPOOL_MACRO} ${SPOOL_FILE_ID}
-            WORKING_DIRECTORY ${SPOOL_DIR}
-            DEPENDS ${TARG_SOURCE_DIR}/${TARG_SOURCE} spooler ${LAST_SENTINEL}
-            COMMENT "Running spooler on ${TARG_SOURCE}"
-            )
-
-        get_source_file_property(SPOOL_DEPS ${SPOOL_SOURCE} OBJECT_DEPENDS)
-        if (SPOOL_DEPS STREQUAL "NOTFOUND")
-            set(SPOOL_DEPS ${SPOOL_DIR}/${SPOOL_SENTINEL})
-        else()
-            list(APPEND SPOOL_DEPS ${SPOOL_DIR}/${SPOOL_SENTINEL})
-        endif()
-        set_source_files_properties(${SPOOL_SOURCE} PROPERTIES OBJECT_DEPENDS "${SPOOL_DEPS}")
-
         MATH(EXPR SPOOL_FILE_ID "${SPOOL_FILE_ID} + 1")
     endforeach()
 
+    if (SPOOL_COMPILER_LAUNCHER)
+        spool_launch(${SPOOL} ${TARG})
+    else()
+        # Merge all parsed sources of the target into the spool database in a single transaction
+        spool_merge(${SPOOL} ${TARG} "${SPOOL_LIST_CONTENTS}" ${SPOOL_LITERAL_FILES})
+    endif()
+
     set_target_properties(${SPOOL} PROPERTIES SPOOL_FILE_COUNTER ${SPOOL_FILE_ID})
 endfunction()
@@ -1,10 +1,273 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// With SPOOL_SHARED, the tables are defined once by the spool's shared library for every module linking it, and must
+// stay visible when those modules hide their own symbols by default
+#if defined(SPOOL_SHARED) && defined(_WIN32)
+#define SPOOL_IMPORT __declspec(dllimport)
+#elif defined(SPOOL_SHARED)
+#define SPOOL_IMPORT __attribute__((visibility("default")))
+#else
+#define SPOOL_IMPORT
+#endif
+
+// Tables emitted by the spooler with one entry per pooled string
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+    SPOOL_IMPORT extern const char spool_blob_[];
+    SPOOL_IMPORT extern const uint32_t spool_count_;
+    SPOOL_IMPORT extern const uint32_t spool_offsets_[];
+    SPOOL_IMPORT extern const uint32_t spool_lengths_[];
+    SPOOL_IMPORT extern const uint64_t spool_hashes_[];
+    SPOOL_IMPORT extern const uint32_t spool_bucket_count_;
+    SPOOL_IMPORT extern const uint32_t spool_seeds_[];
+    SPOOL_IMPORT extern const uint32_t spool_slots_[];
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef SPOOL_TAIL_MERGING
+// Pooled strings may be stored as the tail of longer ones, so entries are numbered in blob order instead and the index
+// of a pooled string is found by binary search over the entry offsets
+static inline uint32_t spool_index(const char* p)
+{
+    uint32_t offset = (uint32_t)(p - spool_blob_);
+    uint32_t first = 0;
+    uint32_t count = spool_count_;
+    while (count != 0)
+    {
+        uint32_t half = count / 2;
+        if (spool_offsets_[first + half] < offset)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return first;
+}
+#else
+// Every pooled string is preceded in memory by the little-endian 32-bit index of its entry in the spool tables
+static inline uint32_t spool_index(const char* p)
+{
+    const unsigned char* index = (const unsigned char*)p - 4;
+    return (uint32_t)index[0] | ((uint32_t)index[1] << 8) | ((uint32_t)index[2] << 16) | ((uint32_t)index[3] << 24);
+}
+#endif
+
+// Length of a pooled string (a pointer produced by SP) without scanning it. Undefined for any other pointer.
+static inline size_t spool_len(const char* p)
+{
+    return spool_lengths_[spool_index(p)];
+}
+
+// 64-bit FNV-1a hash of the contents of a pooled string without scanning it. Undefined for any other pointer.
+static inline uint64_t spool_hash(const char* p)
+{
+    return spool_hashes_[spool_index(p)];
+}
+
+// 64-bit FNV-1a hash of arbitrary bytes, matching spool_hash for pooled strings
+static inline uint64_t spool_hash_bytes(const char* data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i != size; ++i)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Spreads the bits of a hash over all 64 bits (FNV-1a alone leaves the high bits of similar strings nearly equal)
+static inline uint64_t spool_mix_hash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Index of the entry that the minimal perfect hash in the spool tables assigns to a hash. Only the entry of a pooled
+// string with that hash is guaranteed to have it.
+static inline uint32_t spool_index_of_hash(uint64_t hash)
+{
+    uint32_t bucket = (uint32_t)(((spool_mix_hash(hash) >> 32) * spool_bucket_count_) >> 32);
+    uint64_t mixed = spool_mix_hash(hash ^ (spool_seeds_[bucket] * 0x9e3779b97f4a7c15ull));
+    return spool_slots_[((mixed & 0xffffffff) * spool_count_) >> 32];
+}
+
+// Returns the pooled string with the given contents (the same pointer SP produces for it), or NULL if no such string
+// is pooled. The spool tables include a minimal perfect hash over the pooled strings, so this is a single probe and
+// one comparison, and never allocates.
+static inline const char* spool_find(const char* data, size_t size)
+{
+    uint64_t hash = spool_hash_bytes(data, size);
+    uint32_t index = spool_index_of_hash(hash);
+    if (spool_hashes_[index] != hash || spool_lengths_[index] != size
+        || memcmp(spool_blob_ + spool_offsets_[index], data, size) != 0)
+    {
+        return NULL;
+    }
+    return spool_blob_ + spool_offsets_[index];
+}
+
+#ifdef __cplusplus
+namespace spool
+{
+// Handle to a pooled string as its dense index in the spool tables. Ids compare, hash and index containers in O(1)
+// (see spool_map.h) while still converting back to the pooled pointer.
+class id
+{
+public:
+    static constexpr uint32_t invalid_index = UINT32_MAX;
+
+    constexpr id() noexcept = default;
+
+    // The pointer must have been produced by SP
+    explicit id(const char* pooled) noexcept
+        : index_{spool_index(pooled)}
+    {
+    }
+
+    [[nodiscard]] static constexpr id from_index(uint32_t index) noexcept
+    {
+        id out;
+        out.index_ = index;
+        return out;
+    }
+
+    // Number of distinct ids, all of which are below this bound
+    [[nodiscard]] static uint32_t count() noexcept
+    {
+        return spool_count_;
+    }
+
+    [[nodiscard]] constexpr uint32_t index() const noexcept
+    {
+        return index_;
+    }
+
+    [[nodiscard]] constexpr bool valid() const noexcept
+    {
+        return index_ != invalid_index;
+    }
+
+    [[nodiscard]] const char* c_str() const noexcept
+    {
+        return spool_blob_ + spool_offsets_[index_];
+    }
+
+    operator const char*() const noexcept
+    {
+        return c_str();
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return spool_lengths_[index_];
+    }
+
+    [[nodiscard]] uint64_t hash() const noexcept
+    {
+        return spool_hashes_[index_];
+    }
+
+    friend constexpr bool operator==(id lhs, id rhs) noexcept
+    {
+        return lhs.index_ == rhs.index_;
+    }
+
+    friend constexpr bool operator!=(id lhs, id rhs) noexcept
+    {
+        return lhs.index_ != rhs.index_;
+    }
+
+    friend constexpr bool operator<(id lhs, id rhs) noexcept
+    {
+        return lhs.index_ < rhs.index_;
+    }
+
+private:
+    uint32_t index_ = invalid_index;
+};
+
+#if defined(__cpp_consteval)
+#define SPOOL_CONSTEVAL consteval
+#else
+#define SPOOL_CONSTEVAL constexpr
+#endif
+
+// 64-bit FNV-1a hash of the contents of a string literal, matching spool_hash_bytes
+template <size_t N> SPOOL_CONSTEVAL uint64_t literal_hash(const char (&str)[N]) noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i + 1 < N; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(str[i])) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+namespace detail
+{
+// The pooled string with the given hash and length, or the literal itself if no such string is pooled (the literal
+// wasn't scanned by the spooler). The spooler fails to generate a spool in which two strings share a hash.
+template <uint64_t Hash, size_t N> inline const char* find_hashed(const char (&literal)[N]) noexcept
+{
+    uint32_t index = spool_index_of_hash(Hash);
+    if (spool_hashes_[index] != Hash || spool_lengths_[index] != N - 1)
+    {
+        return literal;
+    }
+    return spool_blob_ + spool_offsets_[index];
+}
+} // namespace detail
+} // namespace spool
+
+// Pools a string literal by the hash of its contents, which the compiler computes, rather than by its position in the
+// source. Unlike SP, this works in headers and inline functions, in any source of a target linked with its spool
+// (whether or not it is spooled itself), and alongside other uses of __COUNTER__. The lookup costs a probe of the
+// perfect hash in the spool tables, so prefer SP in sources and hoist SPH out of hot loops.
+#define SPH(str) (::spool::detail::find_hashed<::spool::literal_hash(str)>(str))
+#endif
+
 #ifndef SPOOL_ID
 // No spool id, just pass the contents through intact
 #define SP(str) str
 #else
+#ifdef SPOOL_OFFSET_TABLES
 
-extern const char*** spool_strings_[];
-#define SP(...) *spool_strings_[SPOOL_ID][__COUNTER__]
+// All pooled strings live in a single blob and are addressed with 32-bit offsets, so none of the tables below need
+// relocations from the dynamic loader
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+    SPOOL_IMPORT extern const uint32_t spool_uses_[];
+    SPOOL_IMPORT extern const uint32_t spool_sources_[];
+#ifdef __cplusplus
+}
+#endif
+#define SPOOL_LOOKUP_() (spool_blob_ + spool_uses_[spool_sources_[SPOOL_ID] + __COUNTER__])
+#else
+
+SPOOL_IMPORT extern const char*** spool_strings_[];
+#define SPOOL_LOOKUP_() *spool_strings_[SPOOL_ID][__COUNTER__]
+#endif
+
+#if defined(SPOOL_PROFILE) && defined(__cplusplus)
+// Count every use of a pooled string for `spooler profile` (see spool_profile.h)
+#include "spool_profile.h"
+#define SP(...) ::spool::profile_hit(SPOOL_LOOKUP_())
+#else
+#define SP(...) SPOOL_LOOKUP_()
+#endif
 #endif
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "spool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+// Runtime interning of strings that are only known at runtime (read from files, the network, etc.). Strings that are
+// already pooled resolve to the same pointer SP produces, so runtime data compares equal to literals by pointer.
+// Everything else is copied once into an arena and shared by every later caller. Interning is lock-free and safe to
+// call from any number of threads; interned strings live until the process exits.
+//
+// Only pointers into the spool itself carry the metadata read by spool_len, spool_hash and spool::id.
+
+namespace spool
+{
+namespace detail
+{
+// Header preceding each string copied into the arena
+struct intern_header
+{
+    uint64_t hash;
+    size_t size;
+};
+
+// Append-only memory chunks. Threads claim space with a fetch_add and a full chunk is replaced with a CAS, so no
+// allocation ever waits on another thread.
+class intern_arena
+{
+public:
+    char* allocate(size_t size)
+    {
+        size = (size + alignof(intern_header) - 1) & ~(alignof(intern_header) - 1);
+        chunk* current = current_.load(std::memory_order_acquire);
+        while (true)
+        {
+            if (current != nullptr)
+            {
+                size_t offset = current->used.fetch_add(size, std::memory_order_relaxed);
+                if (offset + size <= current->capacity)
+                {
+                    return current->data() + offset;
+                }
+            }
+
+            size_t capacity = current == nullptr ? initial_capacity : current->capacity * 2;
+            while (capacity < size)
+            {
+                capacity *= 2;
+            }
+
+            chunk* next = new (::operator new(sizeof(chunk) + capacity)) chunk{current, capacity};
+            if (current_.compare_exchange_strong(current, next, std::memory_order_acq_rel))
+            {
+                current = next;
+            }
+            else
+            {
+                // Another thread replaced the chunk first, retry with its chunk
+                ::operator delete(next);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t initial_capacity = 64 * 1024;
+
+    struct chunk
+    {
+        chunk(chunk* previous, size_t capacity) noexcept
+            : previous{previous}
+            , capacity{capacity}
+        {
+        }
+
+        char* data() noexcept
+        {
+            return reinterpret_cast<char*>(this + 1);
+        }
+
+        // Chunks are never freed, the link only keeps them reachable
+        chunk* previous;
+        size_t capacity;
+        std::atomic<size_t> used{0};
+    };
+
+    std::atomic<chunk*> current_{nullptr};
+};
+
+// Open-addressed hash table made of levels that double in size. Slots are written once, and a string is inserted into
+// the first level whose probe window for its hash has a free slot. Since probe windows only ever fill up, every thread
+// looking for the same string walks the same slots in the same order and either finds it or races on the same empty
+// slot, so no string is inserted twice.
+class intern_table
+{
+public:
+    const char* intern(const char* data, size_t size)
+    {
+        uint64_t hash = spool_hash_bytes(data, size);
+        level* current = &first_;
+        while (true)
+        {
+            for (size_t probe = 0; probe != probe_window; ++probe)
+            {
+                std::atomic<const char*>& slot = current->slots[(hash + probe) & current->mask];
+                const char* existing = slot.load(std::memory_order_acquire);
+                if (existing == nullptr)
+                {
+                    const char* inserted = copy(data, size, hash);
+                    if (slot.compare_exchange_strong(existing, inserted, std::memory_order_acq_rel))
+                    {
+                        return inserted;
+                    }
+                    // Lost the slot, the copy is abandoned in the arena. existing now holds the winner.
+                }
+
+                if (matches(existing, data, size, hash))
+                {
+                    return existing;
+                }
+            }
+
+            current = next_level(*current);
+        }
+    }
+
+private:
+    static constexpr size_t probe_window = 16;
+    static constexpr size_t first_level_size = 1024;
+
+    struct level
+    {
+        explicit level(size_t size)
+            : slots{new std::atomic<const char*>[size]}
+            , mask{size - 1}
+        {
+            for (size_t i = 0; i != size; ++i)
+            {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<const char*>* slots;
+        size_t mask;
+        std::atomic<level*> next{nullptr};
+    };
+
+    static bool matches(const char* existing, const char* data, size_t size, uint64_t hash) noexcept
+    {
+        const intern_header* header = reinterpret_cast<const intern_header*>(existing) - 1;
+        return header->hash == hash && header->size == size && std::memcmp(existing, data, size) == 0;
+    }
+
+    const char* copy(const char* data, size_t size, uint64_t hash)
+    {
+        char* out = arena_.allocate(sizeof(intern_header) + size + 1);
+        new (out) intern_header{hash, size};
+        out += sizeof(intern_header);
+        std::memcpy(out, data, size);
+        out[size] = '\0';
+        return out;
+    }
+
+    level* next_level(level& current)
+    {
+        level* next = current.next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            return next;
+        }
+
+        level* created = new level{(current.mask + 1) * 2};
+        if (current.next.compare_exchange_strong(next, created, std::memory_order_acq_rel))
+        {
+            return created;
+        }
+
+        delete[] created->slots;
+        delete created;
+        return next;
+    }
+
+    level first_{first_level_size};
+    intern_arena arena_;
+};
+
+inline intern_table& interned() noexcept
+{
+    static intern_table table;
+    return table;
+}
+} // namespace detail
+} // namespace spool
+
+// Returns the canonical pointer for the given contents: the pooled string if there is one, otherwise a NUL terminated
+// copy shared by every call with the same contents
+inline const char* spool_intern(std::string_view str)
+{
+    if (const char* pooled = spool_find(str.data(), str.size()))
+    {
+        return pooled;
+    }
+    return spool::detail::interned().intern(str.data(), str.size());
+}
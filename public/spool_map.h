@@ -0,0 +1,234 @@
+#pragma once
+
+#include "spool.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Containers keyed on spool::id. Because ids are dense indices into the spool tables, lookups are an array index
+// rather than a hash probe.
+
+namespace spool
+{
+// Map from ids to values. Values are stored contiguously (in insertion order, until an erase moves the last value into
+// the erased slot) and a table of 32-bit slots covering every id locates them, so the per-map overhead is 4 bytes per
+// pooled string regardless of how many entries are present.
+template <typename T> class dense_map
+{
+public:
+    using value_type = std::pair<id, T>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    [[nodiscard]] T* find(id key) noexcept
+    {
+        uint32_t slot = slot_of(key);
+        return slot == empty_slot ? nullptr : &values_[slot].second;
+    }
+
+    [[nodiscard]] const T* find(id key) const noexcept
+    {
+        uint32_t slot = slot_of(key);
+        return slot == empty_slot ? nullptr : &values_[slot].second;
+    }
+
+    [[nodiscard]] bool contains(id key) const noexcept
+    {
+        return slot_of(key) != empty_slot;
+    }
+
+    // Returns the value for key and whether it was newly inserted (in which case it is constructed from args). The key
+    // must be a valid id of this spool.
+    template <typename... Args> std::pair<T*, bool> try_emplace(id key, Args&&... args)
+    {
+        assert(key.index() < id::count());
+        if (slots_.empty())
+        {
+            // Sized lazily so that maps with static storage duration don't depend on initialization order
+            slots_.assign(id::count(), empty_slot);
+        }
+
+        uint32_t& slot = slots_[key.index()];
+        if (slot != empty_slot)
+        {
+            return {&values_[slot].second, false};
+        }
+
+        slot = static_cast<uint32_t>(values_.size());
+        values_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        return {&values_.back().second, true};
+    }
+
+    T& operator[](id key)
+    {
+        return *try_emplace(key).first;
+    }
+
+    bool erase(id key)
+    {
+        uint32_t slot = slot_of(key);
+        if (slot == empty_slot)
+        {
+            return false;
+        }
+
+        if (slot + 1 != values_.size())
+        {
+            values_[slot] = std::move(values_.back());
+            slots_[values_[slot].first.index()] = slot;
+        }
+        values_.pop_back();
+        slots_[key.index()] = empty_slot;
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        for (auto& value : values_)
+        {
+            slots_[value.first.index()] = empty_slot;
+        }
+        values_.clear();
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return values_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return values_.empty();
+    }
+
+    iterator begin() noexcept
+    {
+        return values_.begin();
+    }
+
+    iterator end() noexcept
+    {
+        return values_.end();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return values_.begin();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return values_.end();
+    }
+
+private:
+    static constexpr uint32_t empty_slot = UINT32_MAX;
+
+    uint32_t slot_of(id key) const noexcept
+    {
+        return key.index() < slots_.size() ? slots_[key.index()] : empty_slot;
+    }
+
+    std::vector<uint32_t> slots_;
+    std::vector<value_type> values_;
+};
+
+// Set of ids stored as a bitset over every pooled string
+class flat_set
+{
+public:
+    [[nodiscard]] bool contains(id key) const noexcept
+    {
+        size_t word = key.index() / 64;
+        return word < bits_.size() && (bits_[word] >> (key.index() % 64) & 1) != 0;
+    }
+
+    // Returns true if the key was not already present. The key must be a valid id of this spool.
+    bool insert(id key)
+    {
+        assert(key.index() < id::count());
+        if (bits_.empty())
+        {
+            bits_.assign((id::count() + 63) / 64, 0);
+        }
+
+        uint64_t& word = bits_[key.index() / 64];
+        uint64_t bit = uint64_t{1} << (key.index() % 64);
+        if ((word & bit) != 0)
+        {
+            return false;
+        }
+        word |= bit;
+        ++size_;
+        return true;
+    }
+
+    // Returns true if the key was present
+    bool erase(id key) noexcept
+    {
+        size_t index = key.index() / 64;
+        uint64_t bit = uint64_t{1} << (key.index() % 64);
+        if (index >= bits_.size() || (bits_[index] & bit) == 0)
+        {
+            return false;
+        }
+        bits_[index] &= ~bit;
+        --size_;
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        bits_.clear();
+        size_ = 0;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    // Invokes f with every id in the set in index order
+    template <typename F> void for_each(F&& f) const
+    {
+        for (size_t word = 0; word != bits_.size(); ++word)
+        {
+            for (uint64_t bits = bits_[word]; bits != 0; bits &= bits - 1)
+            {
+                uint32_t bit = 0;
+                while ((bits >> bit & 1) == 0)
+                {
+                    ++bit;
+                }
+                f(id::from_index(static_cast<uint32_t>(word * 64 + bit)));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> bits_;
+    size_t size_ = 0;
+};
+} // namespace spool
+
+namespace std
+{
+template <> struct hash<spool::id>
+{
+    size_t operator()(spool::id key) const noexcept
+    {
+        return key.index();
+    }
+};
+} // namespace std
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "spool.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+
+// Runtime access profile of the pooled strings. Sources compiled with SPOOL_PROFILE defined count every evaluation of
+// SP with a relaxed atomic increment, and write_profile saves the counts for `spooler profile`. Spools generated with
+// --order=profile then store the strings used most by the profiled run first, so they share cache lines and pages.
+
+namespace spool
+{
+namespace detail
+{
+// One counter per entry of the spool tables, allocated on first use and never freed so uses during static
+// destruction are still counted
+inline std::atomic<uint64_t>* profile_counts() noexcept
+{
+    static std::atomic<uint64_t>* counts = new std::atomic<uint64_t>[spool_count_ == 0 ? 1 : spool_count_]();
+    return counts;
+}
+} // namespace detail
+
+// Counts a use of a pooled string (a pointer produced by SP) and returns it
+inline const char* profile_hit(const char* pooled) noexcept
+{
+    detail::profile_counts()[spool_index(pooled)].fetch_add(1, std::memory_order_relaxed);
+    return pooled;
+}
+
+// Number of uses of a pooled string counted so far
+inline uint64_t profile_count(const char* pooled) noexcept
+{
+    return detail::profile_counts()[spool_index(pooled)].load(std::memory_order_relaxed);
+}
+
+// Writes a "[hash] [count]" line for every pooled string used so far, which `spooler profile` reads. Returns false if
+// the file couldn't be written.
+inline bool write_profile(const char* path) noexcept
+{
+    std::FILE* fp = std::fopen(path, "w");
+    if (!fp)
+    {
+        return false;
+    }
+
+    std::atomic<uint64_t>* counts = detail::profile_counts();
+    for (uint32_t i = 0; i != spool_count_; ++i)
+    {
+        uint64_t count = counts[i].load(std::memory_order_relaxed);
+        if (count != 0)
+        {
+            std::fprintf(fp, "%016" PRIx64 " %" PRIu64 "\n", spool_hashes_[i], count);
+        }
+    }
+
+    bool ok = std::ferror(fp) == 0;
+    return std::fclose(fp) == 0 && ok;
+}
+} // namespace spool
@@ -0,0 +1,722 @@
+#include "BinaryStore.hpp"
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace std::chrono_literals;
+
+// File layout: the magic, then records of a one byte kind, a 32-bit payload size and the payload. All integers are
+// little-endian.
+//   string: 32-bit id, escaped spelling
+//   source: 32-bit source id, 64-bit literal hash, 32-bit string id of each literal
+//   profile: 64-bit hash and 64-bit count of each profiled string
+//   commit: empty
+static const char magic[4] = {'S', 'P', 'S', '1'};
+static constexpr size_t record_header = 5;
+
+enum RecordKind : uint8_t
+{
+    string_record = 1,
+    source_record = 2,
+    commit_record = 3,
+    profile_record = 4,
+};
+
+static void put_u32(std::string& out, uint32_t value)
+{
+    for (int i = 0; i != 4; ++i)
+    {
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+static void put_u64(std::string& out, uint64_t value)
+{
+    put_u32(out, static_cast<uint32_t>(value));
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static uint32_t get_u32(const char* in)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8
+           | static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+static uint64_t get_u64(const char* in)
+{
+    return get_u32(in) | static_cast<uint64_t>(get_u32(in + 4)) << 32;
+}
+
+static size_t string_record_size(std::string_view str)
+{
+    return record_header + 4 + str.size();
+}
+
+static size_t source_record_size(size_t use_count)
+{
+    return record_header + 12 + 4 * use_count;
+}
+
+static size_t profile_record_size(size_t count)
+{
+    return record_header + 16 * count;
+}
+
+static void put_record(std::string& out, RecordKind kind, size_t size)
+{
+    out += static_cast<char>(kind);
+    put_u32(out, static_cast<uint32_t>(size));
+}
+
+static void put_string(std::string& out, uint32_t id, std::string_view str)
+{
+    put_record(out, string_record, string_record_size(str) - record_header);
+    stats_count("string records written", 1);
+    put_u32(out, id);
+    out += str;
+}
+
+static void put_source(std::string& out, int id, uint64_t hash, const std::vector<uint32_t>& uses)
+{
+    put_record(out, source_record, source_record_size(uses.size()) - record_header);
+    stats_count("source records written", 1);
+    put_u32(out, static_cast<uint32_t>(id));
+    put_u64(out, hash);
+    for (auto use : uses)
+    {
+        put_u32(out, use);
+    }
+}
+
+static void put_profile(std::string& out, const std::unordered_map<uint64_t, uint64_t>& counts)
+{
+    put_record(out, profile_record, profile_record_size(counts.size()) - record_header);
+    stats_count("profile records written", 1);
+    for (auto [hash, count] : counts)
+    {
+        put_u64(out, hash);
+        put_u64(out, count);
+    }
+}
+
+// Flushes a file written through fp to disk
+static bool sync_file(std::FILE* fp)
+{
+    if (std::fflush(fp) != 0)
+    {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+// Checks a record against the records before it, counting the string ids they recorded. Ids start at 1 like SQLite
+// ROWIDs and are recorded in order, and sources only use recorded strings.
+static bool valid_record(char kind, const char* payload, size_t payload_size, size_t& string_count)
+{
+    switch (kind)
+    {
+    case string_record:
+    {
+        if (payload_size < 4)
+        {
+            return false;
+        }
+        uint32_t id = get_u32(payload);
+        if (id == 0 || id > string_count)
+        {
+            return false;
+        }
+        string_count = std::max<size_t>(string_count, size_t{id} + 1);
+        return true;
+    }
+    case source_record:
+        if (payload_size < 12 || (payload_size - 12) % 4 != 0)
+        {
+            return false;
+        }
+        for (size_t i = 12; i != payload_size; i += 4)
+        {
+            uint32_t use = get_u32(payload + i);
+            if (use == 0 || use >= string_count)
+            {
+                return false;
+            }
+        }
+        return true;
+    case profile_record:
+        return payload_size % 16 == 0;
+    case commit_record:
+        return payload_size == 0;
+    default:
+        return false;
+    }
+}
+
+// Exclusive lock on a file next to the store, held by writers. Readers never lock since they only read up to the last
+// commit, and compaction replaces the file rather than modifying it.
+class StoreLock
+{
+public:
+    explicit StoreLock(const std::string& path)
+    {
+        StatsPhase phase{"lock"};
+        auto start = std::chrono::steady_clock::now();
+        for (int attempt = 0;; ++attempt)
+        {
+            if (try_lock(path))
+            {
+                return;
+            }
+
+            if (std::chrono::steady_clock::now() - start >= 1min)
+            {
+                std::cerr << "Failed to acquire store lock in a 1 minute period: " << path << std::endl;
+                throw std::runtime_error("Failed to acquire store lock");
+            }
+            std::this_thread::sleep_for(1ms * (1 << std::min(attempt, 6)));
+        }
+    }
+
+    StoreLock(const StoreLock&) = delete;
+    StoreLock& operator=(const StoreLock&) = delete;
+
+    ~StoreLock()
+    {
+#ifdef _WIN32
+        CloseHandle(file_);
+#else
+        ::close(fd_);
+#endif
+    }
+
+private:
+    bool try_lock(const std::string& path)
+    {
+#ifdef _WIN32
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE)
+            {
+                std::cerr << "Failed to open store lock: " << path << std::endl;
+                throw std::runtime_error("Failed to open store lock");
+            }
+        }
+        OVERLAPPED overlapped = {};
+        return LockFileEx(file_, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+        if (fd_ == -1)
+        {
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd_ == -1)
+            {
+                std::cerr << "Failed to open store lock: " << path << std::endl;
+                throw std::runtime_error("Failed to open store lock");
+            }
+        }
+        return flock(fd_, LOCK_EX | LOCK_NB) == 0;
+#endif
+    }
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+BinaryStore::BinaryStore(const char* path)
+    : path_{path}
+{
+    load();
+}
+
+void BinaryStore::load()
+{
+    StatsPhase phase{"load"};
+    file_.close();
+    strings_.clear();
+    owned_.clear();
+    ids_.clear();
+    sources_.clear();
+    profile_.clear();
+    counts_.clear();
+    live_strings_ = 0;
+    live_size_ = 0;
+    valid_size_ = 0;
+    loaded_size_ = 0;
+
+    std::error_code error;
+    if (!std::filesystem::exists(path_, error))
+    {
+        // Created by the first write
+        return;
+    }
+
+    loaded_time_ = std::filesystem::last_write_time(path_, error);
+    if (!file_.open(path_.c_str()))
+    {
+        throw std::runtime_error("Failed to open store");
+    }
+
+    const char* data = file_.data();
+    size_t size = file_.size();
+    loaded_size_ = size;
+    if (size < sizeof(magic))
+    {
+        // The first write was interrupted, and the next one starts over
+        return;
+    }
+    if (std::memcmp(data, magic, sizeof(magic)) != 0)
+    {
+        std::cerr << "Not a spool store: " << path_ << '\n';
+        throw std::runtime_error("Not a spool store");
+    }
+
+    // Find the end of the last complete write first, so records of an interrupted write are never applied. Records that
+    // don't make sense are treated the same, and the next write drops them along with the rest of that write.
+    size_t end = sizeof(magic);
+    size_t string_count = 1;
+    for (size_t pos = sizeof(magic); pos + record_header <= size;)
+    {
+        size_t payload_size = get_u32(data + pos + 1);
+        if (payload_size > size - pos - record_header
+            || !valid_record(data[pos], data + pos + record_header, payload_size, string_count))
+        {
+            break;
+        }
+        size_t next = pos + record_header + payload_size;
+        if (data[pos] == commit_record)
+        {
+            end = next;
+        }
+        pos = next;
+    }
+    valid_size_ = end;
+
+    for (size_t pos = sizeof(magic); pos != end;)
+    {
+        const char* payload = data + pos + record_header;
+        size_t payload_size = get_u32(data + pos + 1);
+
+        switch (data[pos])
+        {
+        case string_record:
+        {
+            stats_count("string records read", 1);
+            uint32_t id = get_u32(payload);
+            if (strings_.size() <= id)
+            {
+                strings_.resize(id + 1);
+            }
+            // The view of an empty string still points into the file, so it isn't mistaken for a missing id
+            strings_[id] = {payload + 4, payload_size - 4};
+            break;
+        }
+        case source_record:
+        {
+            stats_count("source records read", 1);
+            Source& source = sources_[static_cast<int>(get_u32(payload))];
+            source.hash = get_u64(payload + 4);
+            source.uses.resize((payload_size - 12) / 4);
+            for (size_t i = 0; i != source.uses.size(); ++i)
+            {
+                source.uses[i] = get_u32(payload + 12 + 4 * i);
+            }
+            break;
+        }
+        case profile_record:
+        {
+            stats_count("profile records read", 1);
+            profile_.clear();
+            for (size_t i = 0; i + 16 <= payload_size; i += 16)
+            {
+                profile_[get_u64(payload + i)] = get_u64(payload + i + 8);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        pos += record_header + payload_size;
+    }
+
+    // Counted once here and kept up to date by writes from then on
+    counts_.resize(strings_.size(), 0);
+    live_size_ = sizeof(magic) + record_header;
+    for (auto& [id, source] : sources_)
+    {
+        retain(source);
+    }
+    if (!profile_.empty())
+    {
+        live_size_ += profile_record_size(profile_.size());
+    }
+}
+
+void BinaryStore::retain(const Source& source)
+{
+    for (auto use : source.uses)
+    {
+        if (counts_[use]++ == 0)
+        {
+            ++live_strings_;
+            live_size_ += string_record_size(strings_[use]);
+        }
+    }
+    live_size_ += source_record_size(source.uses.size());
+}
+
+void BinaryStore::release(const Source& source)
+{
+    for (auto use : source.uses)
+    {
+        if (--counts_[use] == 0)
+        {
+            --live_strings_;
+            live_size_ -= string_record_size(strings_[use]);
+        }
+    }
+    live_size_ -= source_record_size(source.uses.size());
+}
+
+bool BinaryStore::changed_on_disk() const
+{
+    std::error_code error;
+    if (!std::filesystem::exists(path_, error))
+    {
+        return valid_size_ != 0;
+    }
+    return std::filesystem::file_size(path_, error) != loaded_size_
+           || std::filesystem::last_write_time(path_, error) != loaded_time_;
+}
+
+void BinaryStore::refresh()
+{
+    if (changed_on_disk())
+    {
+        load();
+    }
+}
+
+void BinaryStore::drop_torn_write()
+{
+    std::error_code error;
+    auto size = std::filesystem::file_size(path_, error);
+    if (!error && size != valid_size_)
+    {
+        // Windows can't resize a mapped file
+        file_.close();
+        std::filesystem::resize_file(path_, valid_size_);
+        load();
+    }
+}
+
+std::unordered_map<int, uint64_t> BinaryStore::source_hashes()
+{
+    refresh();
+    std::unordered_map<int, uint64_t> out;
+    for (auto& [id, source] : sources_)
+    {
+        out[id] = source.hash;
+    }
+    return out;
+}
+
+size_t BinaryStore::write(const std::vector<std::string_view>& strings, std::vector<SourceLiterals> sources)
+{
+    StoreLock lock{path_ + ".lock"};
+    refresh();
+    drop_torn_write();
+
+    // The hashes read before taking the lock may have been stale
+    std::unordered_map<int, uint64_t> stored;
+    for (auto& source : sources)
+    {
+        auto existing = sources_.find(source.id);
+        if (existing != sources_.end())
+        {
+            stored[source.id] = existing->second.hash;
+        }
+    }
+    std::vector<bool> used = drop_unchanged(stored, strings.size(), sources);
+    if (sources.empty())
+    {
+        return 0;
+    }
+
+    if (ids_.empty())
+    {
+        for (size_t id = 0; id != strings_.size(); ++id)
+        {
+            if (strings_[id].data() != nullptr)
+            {
+                ids_.emplace(strings_[id], static_cast<uint32_t>(id));
+            }
+        }
+    }
+
+    std::string records;
+    if (valid_size_ == 0)
+    {
+        records.append(magic, sizeof(magic));
+    }
+
+    // Ids start at 1 like SQLite ROWIDs
+    if (strings_.empty())
+    {
+        strings_.emplace_back();
+        counts_.emplace_back(0);
+    }
+
+    std::vector<uint32_t> string_ids(strings.size(), 0);
+    for (size_t i = 0; i != strings.size(); ++i)
+    {
+        if (!used[i])
+        {
+            continue;
+        }
+        std::string_view str = strings[i];
+        auto entry = ids_.find(str);
+        if (entry == ids_.end())
+        {
+            uint32_t id = static_cast<uint32_t>(strings_.size());
+            std::string_view owned = owned_.emplace_back(str);
+            strings_.emplace_back(owned);
+            counts_.emplace_back(0);
+            entry = ids_.emplace(owned, id).first;
+            put_string(records, id, owned);
+        }
+        string_ids[i] = entry->second;
+    }
+
+    for (auto& source : sources)
+    {
+        auto [entry, inserted] = sources_.try_emplace(source.id);
+        Source& stored = entry->second;
+        if (!inserted)
+        {
+            release(stored);
+        }
+        stored.hash = source.hash;
+        stored.uses.clear();
+        for (auto use : source.uses)
+        {
+            stored.uses.emplace_back(string_ids[use]);
+        }
+        retain(stored);
+        put_source(records, source.id, stored.hash, stored.uses);
+    }
+    put_record(records, commit_record, 0);
+    append(records);
+
+    // The in-memory state already includes this write
+    std::error_code error;
+    loaded_size_ = valid_size_;
+    loaded_time_ = std::filesystem::last_write_time(path_, error);
+    return sources.size();
+}
+
+void BinaryStore::append(const std::string& records)
+{
+    std::FILE* fp = std::fopen(path_.c_str(), valid_size_ == 0 ? "wb" : "ab");
+    if (!fp)
+    {
+        fprintf(stderr, "Failed to open file for writing: %s", path_.c_str());
+        throw std::runtime_error("Failed to open store for writing");
+    }
+    std::fwrite(records.data(), 1, records.size(), fp);
+    bool ok = std::ferror(fp) == 0;
+    ok = std::fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write file: %s", path_.c_str());
+        throw std::runtime_error("Failed to write store");
+    }
+    valid_size_ += records.size();
+}
+
+void BinaryStore::write_profile(const std::unordered_map<uint64_t, uint64_t>& counts)
+{
+    StoreLock lock{path_ + ".lock"};
+    refresh();
+    drop_torn_write();
+
+    std::string records;
+    if (valid_size_ == 0)
+    {
+        records.append(magic, sizeof(magic));
+    }
+    put_profile(records, counts);
+    put_record(records, commit_record, 0);
+    append(records);
+
+    if (!profile_.empty())
+    {
+        live_size_ -= profile_record_size(profile_.size());
+    }
+    if (!counts.empty())
+    {
+        live_size_ += profile_record_size(counts.size());
+    }
+    profile_ = counts;
+    std::error_code error;
+    loaded_size_ = valid_size_;
+    loaded_time_ = std::filesystem::last_write_time(path_, error);
+}
+
+std::unordered_map<uint64_t, uint64_t> BinaryStore::profile()
+{
+    return profile_;
+}
+
+// Rewrites the file with only the strings that are still referenced, renumbered from 1 in their current order, and the
+// latest literals of every source. The new file replaces the old one atomically, so readers holding the old file are
+// unaffected.
+void BinaryStore::rewrite()
+{
+    StatsPhase phase{"compact"};
+    std::vector<uint32_t> new_ids(strings_.size(), 0);
+    uint32_t next_id = 1;
+
+    std::string records{magic, sizeof(magic)};
+    for (size_t id = 0; id != strings_.size(); ++id)
+    {
+        if (counts_[id] != 0)
+        {
+            new_ids[id] = next_id++;
+            put_string(records, new_ids[id], strings_[id]);
+        }
+    }
+    std::vector<uint32_t> uses;
+    for (auto& [id, source] : sources_)
+    {
+        uses.clear();
+        for (auto use : source.uses)
+        {
+            uses.emplace_back(new_ids[use]);
+        }
+        put_source(records, id, source.hash, uses);
+    }
+    if (!profile_.empty())
+    {
+        put_profile(records, profile_);
+    }
+    put_record(records, commit_record, 0);
+
+    std::string tmp_path = path_ + ".tmp";
+    std::FILE* fp = std::fopen(tmp_path.c_str(), "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Failed to open file for writing: %s", tmp_path.c_str());
+        throw std::runtime_error("Failed to compact store");
+    }
+    std::fwrite(records.data(), 1, records.size(), fp);
+    // The new file must be complete on disk before it replaces the old one
+    bool ok = std::ferror(fp) == 0 && sync_file(fp);
+    ok = std::fclose(fp) == 0 && ok;
+
+    // Windows can't replace a mapped file. Nothing refers to the old mapping from here on, until it is loaded again.
+    file_.close();
+    std::error_code error;
+    if (ok)
+    {
+        std::filesystem::rename(tmp_path, path_, error);
+    }
+    load();
+    if (!ok || error)
+    {
+        fprintf(stderr, "Failed to write file: %s", path_.c_str());
+        throw std::runtime_error("Failed to compact store");
+    }
+}
+
+StoreUsage BinaryStore::usage()
+{
+    refresh();
+    StoreUsage usage;
+    usage.live_ids = live_strings_;
+    // Id 0 is never used
+    usage.id_space = strings_.empty() ? 0 : strings_.size() - 1;
+    usage.size = valid_size_;
+    usage.live_size = valid_size_ == 0 ? 0 : live_size_;
+    return usage;
+}
+
+void BinaryStore::compact()
+{
+    StoreLock lock{path_ + ".lock"};
+    refresh();
+    if (valid_size_ != 0)
+    {
+        rewrite();
+    }
+}
+
+void BinaryStore::begin_read()
+{
+    // The store is held in memory, which is the snapshot every read sees. A long-lived store (see `spooler serve`)
+    // picks up writes made by other processes since it was loaded.
+    refresh();
+}
+
+void BinaryStore::end_read()
+{
+}
+
+void BinaryStore::for_each_string(const std::function<void(int, std::string_view)>& f)
+{
+    std::vector<uint32_t> ids;
+    for (size_t id = 0; id != counts_.size(); ++id)
+    {
+        if (counts_[id] != 0)
+        {
+            ids.emplace_back(static_cast<uint32_t>(id));
+        }
+    }
+
+    // Same order as the SQLite store: most referenced first, then by id
+    std::sort(ids.begin(), ids.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return counts_[lhs] != counts_[rhs] ? counts_[lhs] > counts_[rhs] : lhs < rhs;
+    });
+
+    for (auto id : ids)
+    {
+        f(static_cast<int>(id), strings_[id]);
+    }
+}
+
+void BinaryStore::for_each_use(const std::function<void(int, int)>& f)
+{
+    for (auto& [id, source] : sources_)
+    {
+        for (auto use : source.uses)
+        {
+            f(id, static_cast<int>(use));
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "Store.hpp"
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Store in a native binary format: a log of records that is only ever appended to. Strings are recorded once when they
+// are first used, sources are recorded with all of their literals whenever they change, a profile replaces the last
+// one, and every write ends with a commit record. Loading maps the file and replays it up to the last commit, so an
+// interrupted write is simply ignored. Writes never compact the file; compacting (see `spooler compact` and generate's
+// --compact-above) replaces it with a new file holding only the live records, with the strings renumbered densely.
+class BinaryStore : public Store
+{
+public:
+    explicit BinaryStore(const char* path);
+
+    std::unordered_map<int, uint64_t> source_hashes() override;
+    size_t write(const std::vector<std::string_view>& strings, std::vector<SourceLiterals> sources) override;
+    void begin_read() override;
+    void end_read() override;
+    void for_each_string(const std::function<void(int, std::string_view)>& f) override;
+    void for_each_use(const std::function<void(int, int)>& f) override;
+    void write_profile(const std::unordered_map<uint64_t, uint64_t>& counts) override;
+    std::unordered_map<uint64_t, uint64_t> profile() override;
+    StoreUsage usage() override;
+    void compact() override;
+
+private:
+    struct Source
+    {
+        uint64_t hash;
+        std::vector<uint32_t> uses;
+    };
+
+    void load();
+    // True if another process wrote to the file since it was loaded
+    bool changed_on_disk() const;
+    // Reloads the file if it changed on disk
+    void refresh();
+    // Truncates the file, which must be locked, to the end of the last commit, so appends don't follow the records of
+    // an interrupted write
+    void drop_torn_write();
+    // Appends complete records to the file, which must be locked
+    void append(const std::string& records);
+    // Add or remove the references of a source to the counts and the live size
+    void retain(const Source& source);
+    void release(const Source& source);
+    // Compacts the file, which must be locked
+    void rewrite();
+
+    std::string path_;
+    MappedFile file_;
+    // Bytes of the file up to the end of the last commit record
+    size_t valid_size_ = 0;
+    // Size and modification time of the file as of the last load or write, to detect writes by other processes
+    size_t loaded_size_ = 0;
+    std::filesystem::file_time_type loaded_time_;
+
+    // Escaped spelling of each string by id, pointing into the mapped file or owned_. Ids that are no longer stored
+    // hold a null view.
+    std::vector<std::string_view> strings_;
+    std::deque<std::string> owned_;
+    // Built the first time strings are written
+    std::unordered_map<std::string_view, uint32_t> ids_;
+    // Ordered by source id
+    std::map<int, Source> sources_;
+    std::unordered_map<uint64_t, uint64_t> profile_;
+    // Number of sources using each string id, the number of ids in use, and the size the file would have if compacted
+    std::vector<uint32_t> counts_;
+    size_t live_strings_ = 0;
+    size_t live_size_ = 0;
+};
@@ -0,0 +1,87 @@
+#include "Changes.hpp"
+#include "Hash.hpp"
+#include "Stats.hpp"
+
+Changes::Changes(Store& store)
+    : store_{store}
+{
+}
+
+bool Changes::add(int source_id, const std::vector<std::string_view>& literals)
+{
+    // Each literal is prefixed with its length so that differently split lists can't hash the same
+    uint64_t hash = hash_offset;
+    for (auto& str : literals)
+    {
+        uint64_t size = str.size();
+        hash = hash_bytes(reinterpret_cast<const char*>(&size), sizeof(size), hash);
+        hash = hash_string(str, hash);
+    }
+
+    if (!hashes_loaded_)
+    {
+        hashes_ = store_.source_hashes();
+        hashes_loaded_ = true;
+    }
+
+    // Skipping on hashes that are stale by now is still correct: the source is as if it had been written before whatever
+    // changed it since. Sources that are written are checked again within the write.
+    auto old_hash = hashes_.find(source_id);
+    if (old_hash != hashes_.end() && old_hash->second == hash)
+    {
+        return false;
+    }
+    hashes_[source_id] = hash;
+
+    SourceLiterals& source = sources_.emplace_back(SourceLiterals{source_id, hash, {}});
+    source.uses.reserve(literals.size());
+    for (auto& str : literals)
+    {
+        auto [entry, inserted] = string_indices_.emplace(str, static_cast<uint32_t>(strings_.size()));
+        if (inserted)
+        {
+            strings_.emplace_back(&entry->first);
+        }
+        source.uses.emplace_back(entry->second);
+    }
+    return true;
+}
+
+size_t Changes::commit()
+{
+    if (sources_.empty())
+    {
+        return 0;
+    }
+
+    // A source recorded more than once only keeps its last literals
+    std::unordered_map<int, size_t> latest;
+    for (size_t i = 0; i != sources_.size(); ++i)
+    {
+        latest[sources_[i].id] = i;
+    }
+
+    std::vector<SourceLiterals> sources;
+    for (size_t i = 0; i != sources_.size(); ++i)
+    {
+        if (latest[sources_[i].id] == i)
+        {
+            sources.emplace_back(std::move(sources_[i]));
+        }
+    }
+
+    std::vector<std::string_view> strings;
+    strings.reserve(strings_.size());
+    for (auto* str : strings_)
+    {
+        strings.emplace_back(*str);
+    }
+
+    StatsPhase phase{"write"};
+    size_t written = store_.write(strings, std::move(sources));
+
+    sources_.clear();
+    string_indices_.clear();
+    strings_.clear();
+    return written;
+}
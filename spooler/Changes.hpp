@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Store.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Accumulates the literals of changed sources in memory so they can be written to the store at once
+class Changes
+{
+public:
+    Changes(Store& store);
+    Changes(const Changes&) = delete;
+    Changes(Changes&&) = delete;
+    Changes& operator=(const Changes&) = delete;
+    Changes& operator=(Changes&&) = delete;
+
+    // Records the ordered literals most recently parsed from a source. Returns false if they hash the same as when the
+    // source was last committed, in which case nothing is recorded.
+    bool add(int source_id, const std::vector<std::string_view>& literals);
+
+    // Writes every recorded source to the store, and returns the number of sources it wrote. Sources that another
+    // spooler has written the same literals for since they were added are left out.
+    size_t commit();
+
+private:
+    Store& store_;
+    bool hashes_loaded_ = false;
+    std::unordered_map<int, uint64_t> hashes_;
+    // Literals index into strings_
+    std::vector<SourceLiterals> sources_;
+    // Distinct literals of all recorded sources, in order of first use
+    std::unordered_map<std::string, uint32_t> string_indices_;
+    std::vector<const std::string*> strings_;
+};
@@ -0,0 +1,372 @@
+#include "Daemon.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Protocol, on a stream socket:
+//   request: 32-bit version, 32-bit payload size, carrying the client's stdout and stderr as SCM_RIGHTS. Then the
+//            payload: the working directory and each argument, all null-terminated.
+//   reply:   32-bit exit code of the command
+// A daemon that can't handle a request closes the connection without replying, and the client runs the command itself.
+static constexpr uint32_t protocol_version = 1;
+
+std::string default_socket_path()
+{
+    if (const char* path = std::getenv("SPOOLER_SOCKET"))
+    {
+        return path;
+    }
+#ifdef _WIN32
+    return {};
+#else
+    if (const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR"))
+    {
+        return std::string{runtime_dir} + "/spooler.sock";
+    }
+    return "/tmp/spooler-" + std::to_string(getuid()) + ".sock";
+#endif
+}
+
+#ifdef _WIN32
+
+int serve(const char*, const CommandHandler&)
+{
+    fprintf(stderr, "spooler serve is not supported on this platform");
+    return 1;
+}
+
+bool run_in_daemon(const char*, int, char**, int&)
+{
+    return false;
+}
+
+#else
+
+static bool make_address(const char* socket_path, sockaddr_un& address)
+{
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    std::strcpy(address.sun_path, socket_path);
+    return true;
+}
+
+static int connect_to(const char* socket_path)
+{
+    sockaddr_un address;
+    if (!make_address(socket_path, address))
+    {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool read_all(int fd, void* data, size_t size)
+{
+    char* out = static_cast<char*>(data);
+    while (size != 0)
+    {
+        ssize_t count = read(fd, out, size);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        out += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+static bool write_all(int fd, const void* data, size_t size)
+{
+    const char* in = static_cast<const char*>(data);
+    while (size != 0)
+    {
+        ssize_t count = write(fd, in, size);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        in += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// Receives the request header along with the client's stdout and stderr
+static bool receive_header(int fd, uint32_t (&header)[2], int (&streams)[2])
+{
+    char control[CMSG_SPACE(sizeof(streams))];
+    iovec data = {header, sizeof(header)};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t count;
+    do
+    {
+        count = recvmsg(fd, &message, 0);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0)
+    {
+        return false;
+    }
+
+    cmsghdr* fds = CMSG_FIRSTHDR(&message);
+    if (!fds || fds->cmsg_level != SOL_SOCKET || fds->cmsg_type != SCM_RIGHTS
+        || fds->cmsg_len != CMSG_LEN(sizeof(streams)))
+    {
+        return false;
+    }
+    std::memcpy(streams, CMSG_DATA(fds), sizeof(streams));
+
+    // The descriptors arrive with the first byte, so the rest of the header may be read normally
+    return read_all(fd, reinterpret_cast<char*>(header) + count, sizeof(header) - count);
+}
+
+// Runs a command with the working directory and standard streams of the client
+static int run_as_client(const CommandHandler& handler, std::vector<std::string>& args, const int (&streams)[2])
+{
+    if (chdir(args[0].c_str()) != 0)
+    {
+        fprintf(stderr, "Failed to enter the client's working directory: %s\n", args[0].c_str());
+        return -1;
+    }
+
+    std::vector<char*> argv;
+    for (size_t i = 1; i != args.size(); ++i)
+    {
+        argv.emplace_back(args[i].data());
+    }
+    argv.emplace_back(nullptr);
+
+    std::fflush(stdout);
+    std::fflush(stderr);
+    int saved_out = dup(STDOUT_FILENO);
+    int saved_err = dup(STDERR_FILENO);
+    dup2(streams[0], STDOUT_FILENO);
+    dup2(streams[1], STDERR_FILENO);
+
+    int result = handler(static_cast<int>(argv.size() - 1), argv.data());
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(stdout);
+    std::fflush(stderr);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(saved_out);
+    close(saved_err);
+    return result;
+}
+
+static void handle(int fd, const CommandHandler& handler)
+{
+    uint32_t header[2];
+    int streams[2] = {-1, -1};
+    if (!receive_header(fd, header, streams))
+    {
+        return;
+    }
+
+    std::string payload(header[1], '\0');
+    std::vector<std::string> args;
+    if (header[0] == protocol_version && read_all(fd, payload.data(), payload.size()))
+    {
+        for (size_t begin = 0; begin < payload.size();)
+        {
+            size_t end = payload.find('\0', begin);
+            if (end == std::string::npos)
+            {
+                break;
+            }
+            args.emplace_back(payload, begin, end - begin);
+            begin = end + 1;
+        }
+    }
+    else if (header[0] != protocol_version)
+    {
+        fprintf(stderr, "Ignoring a request from a spooler with a different protocol version\n");
+    }
+
+    // At least the working directory and the command
+    if (args.size() >= 3)
+    {
+        int result = run_as_client(handler, args, streams);
+        if (result != -1)
+        {
+            int32_t reply = result;
+            write_all(fd, &reply, sizeof(reply));
+        }
+    }
+
+    close(streams[0]);
+    close(streams[1]);
+}
+
+int serve(const char* socket_path, const CommandHandler& handler)
+{
+    sockaddr_un address;
+    if (!make_address(socket_path, address))
+    {
+        fprintf(stderr, "Socket path is too long: %s", socket_path);
+        return 1;
+    }
+
+    // Replace the socket of a daemon that is gone, but never take over from one that is still running
+    int existing = connect_to(socket_path);
+    if (existing != -1)
+    {
+        close(existing);
+        fprintf(stderr, "A spooler is already serving on %s", socket_path);
+        return 1;
+    }
+    unlink(socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to create socket: %s", std::strerror(errno));
+        return 1;
+    }
+
+    // Only the user running the daemon may connect to it
+    mode_t mask = umask(0077);
+    int bound = bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    umask(mask);
+    if (bound != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "Failed to listen on %s: %s", socket_path, std::strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    // A client that goes away mid-command must not take the daemon with it
+    std::signal(SIGPIPE, SIG_IGN);
+
+    printf("Serving on %s\n", socket_path);
+    std::fflush(stdout);
+
+    while (true)
+    {
+        int client = accept(fd, nullptr, nullptr);
+        if (client == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            fprintf(stderr, "Failed to accept connection: %s", std::strerror(errno));
+            close(fd);
+            return 1;
+        }
+
+        handle(client, handler);
+        close(client);
+    }
+}
+
+bool run_in_daemon(const char* socket_path, int argc, char** argv, int& result)
+{
+    // Only trust a socket owned by this user
+    struct stat info;
+    if (*socket_path == '\0' || stat(socket_path, &info) != 0 || !S_ISSOCK(info.st_mode) || info.st_uid != getuid())
+    {
+        return false;
+    }
+
+    std::vector<char> cwd(4096);
+    if (!getcwd(cwd.data(), cwd.size()))
+    {
+        return false;
+    }
+
+    std::string payload{cwd.data()};
+    payload += '\0';
+    for (int i = 0; i != argc; ++i)
+    {
+        payload += argv[i];
+        payload += '\0';
+    }
+
+    int fd = connect_to(socket_path);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    // If the daemon goes away, fail the write and run the command here instead
+    std::signal(SIGPIPE, SIG_IGN);
+
+    uint32_t header[2] = {protocol_version, static_cast<uint32_t>(payload.size())};
+    int streams[2] = {STDOUT_FILENO, STDERR_FILENO};
+    char control[CMSG_SPACE(sizeof(streams))] = {};
+    iovec data = {header, sizeof(header)};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* fds = CMSG_FIRSTHDR(&message);
+    fds->cmsg_level = SOL_SOCKET;
+    fds->cmsg_type = SCM_RIGHTS;
+    fds->cmsg_len = CMSG_LEN(sizeof(streams));
+    std::memcpy(CMSG_DATA(fds), streams, sizeof(streams));
+
+    ssize_t sent;
+    do
+    {
+        sent = sendmsg(fd, &message, 0);
+    } while (sent < 0 && errno == EINTR);
+
+    int32_t reply;
+    bool ok = sent > 0 && write_all(fd, reinterpret_cast<char*>(header) + sent, sizeof(header) - sent)
+              && write_all(fd, payload.data(), payload.size()) && read_all(fd, &reply, sizeof(reply));
+    close(fd);
+
+    if (ok)
+    {
+        result = reply;
+    }
+    return ok;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// A long-lived `spooler serve` process keeps every store it has opened in memory and runs commands on behalf of
+// short-lived spooler invocations, which connect over a Unix socket. Clients hand over their working directory and
+// standard streams, so a command run by the daemon behaves exactly as if it had run in the client.
+
+// The socket named by the SPOOLER_SOCKET environment variable, or spooler.sock in the user's runtime directory. An
+// empty SPOOLER_SOCKET disables the daemon.
+std::string default_socket_path();
+
+// Runs a command given its arguments as they were passed to the spooler
+using CommandHandler = std::function<int(int argc, char** argv)>;
+
+// Listens on socket_path and handles one command at a time until the process is killed. Returns nonzero if the socket
+// couldn't be listened on.
+int serve(const char* socket_path, const CommandHandler& handler);
+
+// Runs a command in the daemon listening on socket_path and stores its exit code in result. Returns false if there is
+// no daemon or it couldn't run the command, in which case the caller should run it itself.
+bool run_in_daemon(const char* socket_path, int argc, char** argv, int& result);
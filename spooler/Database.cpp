@@ -1,5 +1,7 @@
 #include "Database.hpp"
+#include "Stats.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <thread>
@@ -15,13 +17,19 @@ Database::Database(const char* path)
         throw std::runtime_error("Failed to open db");
         return;
     }
+
+    sqlite3_busy_handler(db_, on_busy, this);
+    // With a write-ahead log, readers and the single writer don't block each other, and commits only need to sync at
+    // checkpoints. A crash may lose the last commits but never corrupts the database, which the next build repopulates.
+    execute("PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;");
 }
 
 Database::~Database()
 {
-    if (locked_)
+    if (in_transaction_)
     {
-        sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+        // Transactions that weren't committed explicitly were interrupted by an error
+        sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
     }
     sqlite3_close(db_);
 }
@@ -40,36 +48,69 @@ Statement Database::prepare(const char* statement)
     return {out, statement, db_};
 }
 
+void Database::execute(const char* statements)
+{
+    char* error = nullptr;
+    int result = sqlite3_exec(db_, statements, nullptr, nullptr, &error);
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Failed to execute statements: " << statements << '\n';
+        std::cerr << (error ? error : sqlite3_errmsg(db_)) << '\n';
+        sqlite3_free(error);
+        throw std::runtime_error("Failed to execute statements");
+    }
+}
+
 int Database::last_insert_rowid()
 {
     return sqlite3_last_insert_rowid(db_);
 }
 
-void Database::lock()
+// Waits with exponential backoff (1ms up to 64ms between attempts) until the database has been busy for a minute
+int Database::on_busy(void* context, int attempt)
 {
-    if (locked_)
+    Database& db = *static_cast<Database*>(context);
+    auto now = std::chrono::steady_clock::now();
+    if (attempt == 0)
     {
-        return;
+        db.busy_since_ = now;
+    }
+    else if (now - db.busy_since_ >= 1min)
+    {
+        return 0;
     }
 
-    char* error;
-    // https://www.sqlite.org/c3ref/exec.html
-
-    auto try_duration = 0ms;
+    std::this_thread::sleep_for(1ms * (1 << std::min(attempt, 6)));
+    return 1;
+}
 
-    while (try_duration < 1min)
+void Database::begin_write()
+{
+    // IMMEDIATE takes the write lock up front, so the busy handler covers the wait instead of the transaction failing
+    // when it first writes
+    StatsPhase phase{"lock"};
+    int result = sqlite3_exec(db_, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+    if (result == SQLITE_BUSY)
     {
-        int result = sqlite3_exec(db_, "PRAGMA locking_mode = EXCLUSIVE; BEGIN EXCLUSIVE;", nullptr, nullptr, &error);
-        if (result == SQLITE_OK)
-        {
-            locked_ = true;
-            return;
-        }
-
-        try_duration += 5ms;
-        std::this_thread::sleep_for(50ms);
+        std::cerr << "Failed to acquire database lock in a 1 minute period" << std::endl;
+        throw std::runtime_error("Failed to acquire db lock");
+    }
+    if (result != SQLITE_OK)
+    {
+        std::cerr << "Failed to begin transaction: " << sqlite3_errmsg(db_) << std::endl;
+        throw std::runtime_error("Failed to begin transaction");
     }
+    in_transaction_ = true;
+}
 
-    std::cerr << "Failed to acquire database lock in a 1 minute period" << std::endl;
-    throw std::runtime_error("Failed to acquire db lock");
+void Database::begin_read()
+{
+    execute("BEGIN DEFERRED;");
+    in_transaction_ = true;
+}
+
+void Database::commit()
+{
+    execute("COMMIT;");
+    in_transaction_ = false;
 }
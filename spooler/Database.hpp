@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Statement.hpp"
+#include <chrono>
 #include <sqlite3.h>
 
 class Database
@@ -14,16 +15,27 @@ public:
     ~Database();
 
     Statement prepare(const char* statement);
+    // Runs one or more statements that produce no rows
+    void execute(const char* statements);
     int last_insert_rowid();
 
-    void lock();
+    // Starts a write transaction, waiting for other writers according to the busy policy. Readers are never blocked
+    // since the database uses a write-ahead log.
+    void begin_write();
+    // Starts a read transaction so that consecutive queries see a single snapshot of the database
+    void begin_read();
+    void commit();
+
     [[nodiscard]] sqlite3* handle() const noexcept
     {
         return db_;
     }
 
 private:
+    static int on_busy(void* context, int attempt);
+
     sqlite3* db_;
-    bool locked_ = false;
+    bool in_transaction_ = false;
+    std::chrono::steady_clock::time_point busy_since_;
 };
 
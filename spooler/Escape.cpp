@@ -0,0 +1,163 @@
+#include "Escape.hpp"
+
+#include <cstdint>
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static void append_utf8(uint32_t code_point, std::string& out)
+{
+    if (code_point < 0x80)
+    {
+        out += static_cast<char>(code_point);
+    }
+    else if (code_point < 0x800)
+    {
+        out += static_cast<char>(0xc0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+    else if (code_point < 0x10000)
+    {
+        out += static_cast<char>(0xe0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+    else
+    {
+        out += static_cast<char>(0xf0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+}
+
+std::string unescape(std::string_view literal)
+{
+    std::string out;
+    out.reserve(literal.size());
+
+    size_t i = 0;
+    while (i < literal.size())
+    {
+        char c = literal[i++];
+        if (c != '\\' || i == literal.size())
+        {
+            out += c;
+            continue;
+        }
+
+        c = literal[i++];
+        switch (c)
+        {
+        case 'a':
+            out += '\a';
+            break;
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'v':
+            out += '\v';
+            break;
+        case '\r':
+            // Line splice, possibly with a CRLF line ending
+            if (i < literal.size() && literal[i] == '\n')
+            {
+                ++i;
+            }
+            break;
+        case '\n':
+            // Line splice
+            break;
+        case 'x':
+        {
+            unsigned value = 0;
+            int digit;
+            while (i < literal.size() && (digit = hex_value(literal[i])) >= 0)
+            {
+                value = (value << 4) | digit;
+                ++i;
+            }
+            out += static_cast<char>(value);
+            break;
+        }
+        case 'u':
+        case 'U':
+        {
+            size_t digits = c == 'u' ? 4 : 8;
+            uint32_t code_point = 0;
+            int digit;
+            for (; digits != 0 && i < literal.size() && (digit = hex_value(literal[i])) >= 0; --digits, ++i)
+            {
+                code_point = (code_point << 4) | digit;
+            }
+            append_utf8(code_point, out);
+            break;
+        }
+        default:
+            if (c >= '0' && c <= '7')
+            {
+                unsigned value = c - '0';
+                for (int digits = 1; digits != 3 && i < literal.size() && literal[i] >= '0' && literal[i] <= '7';
+                     ++digits, ++i)
+                {
+                    value = (value << 3) | (literal[i] - '0');
+                }
+                out += static_cast<char>(value);
+            }
+            else
+            {
+                // Covers \\, \", \' and \? along with unknown escapes, which compilers treat as the character itself
+                out += c;
+            }
+            break;
+        }
+    }
+
+    return out;
+}
+
+void escape(std::string_view bytes, std::string& out)
+{
+    for (char c : bytes)
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        // '?' is escaped to avoid forming trigraphs in C and pre-C++17 compilers
+        if (u >= 0x20 && u < 0x7f && c != '"' && c != '\\' && c != '?')
+        {
+            out += c;
+        }
+        else
+        {
+            out += '\\';
+            out += static_cast<char>('0' + (u >> 6));
+            out += static_cast<char>('0' + ((u >> 3) & 7));
+            out += static_cast<char>('0' + (u & 7));
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Literals are stored in the spool database as spelled in source (escape sequences and all). These helpers convert
+// between that spelling and the bytes the compiler would actually place in memory.
+
+// Decodes the escape sequences (and line splices) of a C string literal body into the bytes it denotes. Universal
+// character names are encoded as UTF-8.
+std::string unescape(std::string_view literal);
+
+// Appends `bytes` to `out` spelled so that it is valid as the body of a C string literal. Printable ASCII is copied
+// as is, everything else is written as a three digit octal escape so that it can't absorb a following character.
+void escape(std::string_view bytes, std::string& out);
@@ -1,51 +1,451 @@
 #include "Generator.hpp"
-#include "Database.hpp"
+#include "Escape.hpp"
+#include "Hash.hpp"
+#include "Store.hpp"
 
-#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 
-Generator::Generator(Database& db, std::FILE* fp)
-    : db_{db}
-    , fp_{fp}
+Generator::Generator(Store& store, const GeneratorOptions& options)
+    : store_{store}
+    , options_{options}
 {
 }
 
+// Finds for every string a string it is a suffix of, which is itself if there is none. Sorted by their reversed
+// contents, the strings that a string is a suffix of directly follow it, and the last of those is the longest.
+static std::vector<uint32_t> suffix_hosts(const std::vector<const std::string*>& strings)
+{
+    std::vector<uint32_t> order(strings.size());
+    for (uint32_t i = 0; i != order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return std::lexicographical_compare(
+            strings[lhs]->rbegin(), strings[lhs]->rend(), strings[rhs]->rbegin(), strings[rhs]->rend());
+    });
+
+    std::vector<uint32_t> hosts(strings.size());
+    for (size_t i = order.size(); i-- != 0;)
+    {
+        uint32_t current = order[i];
+        hosts[current] = current;
+        if (i + 1 == order.size())
+        {
+            continue;
+        }
+
+        uint32_t next = order[i + 1];
+        const std::string& str = *strings[current];
+        const std::string& longer = *strings[next];
+        if (longer.size() > str.size() && longer.compare(longer.size() - str.size(), str.size(), str) == 0)
+        {
+            hosts[current] = hosts[next];
+        }
+    }
+    return hosts;
+}
+
+// Appends bytes as a list of character literals. The blob is an array of those rather than one concatenated string
+// literal, which MSVC limits to 64 KiB (C1091).
+static void append_chars(std::string_view bytes, std::string& out)
+{
+    for (char c : bytes)
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        out += '\'';
+        if (u >= 0x20 && u < 0x7f && c != '\'' && c != '\\' && c != '?')
+        {
+            out += c;
+        }
+        else
+        {
+            out += '\\';
+            out += static_cast<char>('0' + (u >> 6));
+            out += static_cast<char>('0' + ((u >> 3) & 7));
+            out += static_cast<char>('0' + (u & 7));
+        }
+        out += "',";
+    }
+}
+
+void Generator::order_strings(std::vector<std::pair<int, std::string>>& live)
+{
+    if (options_.order == StringOrder::source)
+    {
+        std::unordered_map<int, size_t> first_use;
+        size_t position = 0;
+        store_.for_each_use([&](int, int id) { first_use.emplace(id, position++); });
+        std::stable_sort(live.begin(), live.end(), [&](const auto& lhs, const auto& rhs) {
+            return first_use[lhs.first] < first_use[rhs.first];
+        });
+    }
+    else if (options_.order == StringOrder::profile)
+    {
+        // Strings the profiled run never used keep their order behind all the strings it did use
+        std::unordered_map<uint64_t, uint64_t> counts = store_.profile();
+        std::vector<std::pair<uint64_t, size_t>> keys(live.size());
+        for (size_t i = 0; i != live.size(); ++i)
+        {
+            auto count = counts.find(hash_string(live[i].second));
+            keys[i] = {count == counts.end() ? 0 : count->second, i};
+        }
+        std::sort(keys.begin(), keys.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+        });
+
+        std::vector<std::pair<int, std::string>> ordered;
+        ordered.reserve(live.size());
+        for (auto [count, i] : keys)
+        {
+            ordered.emplace_back(std::move(live[i]));
+        }
+        live = std::move(ordered);
+    }
+}
+
 void Generator::write_strings()
 {
     static const char* h1 =
         "// AUTOGENERATED BY spooler/Generator.{h,c}pp\n"
         "\n"
-        "// fs = flattened strings\n"
-        "static const char* fs[] = {\n";
+        "#include <cstdint>\n"
+        "\n"
+        "#if defined(__cpp_constinit)\n"
+        "#define SPOOL_CONSTINIT constinit\n"
+        "#else\n"
+        "#define SPOOL_CONSTINIT\n"
+        "#endif\n"
+        "\n"
+        "// Shared spools export the tables and nothing else. The tables keep default visibility, as executables may\n"
+        "// copy them into their own data through copy relocations, which protected symbols don't support.\n"
+        "#if defined(SPOOL_SHARED) && defined(_WIN32)\n"
+        "#define SPOOL_EXPORT __declspec(dllexport)\n"
+        "#elif defined(SPOOL_SHARED)\n"
+        "#define SPOOL_EXPORT __attribute__((visibility(\"default\")))\n"
+        "#else\n"
+        "#define SPOOL_EXPORT\n"
+        "#endif\n"
+        "\n"
+        "// All live strings, NUL separated.";
+    static const char* h1_references = " The most referenced strings come first so that hot strings share cache\n"
+                                       "// lines and pages.";
+    static const char* h1_source = " Strings are stored in order of first use so that the strings of each source\n"
+                                   "// share cache lines and pages.";
+    static const char* h1_profile = " The strings used most by the profiled run come first so that hot strings share\n"
+                                    "// cache lines and pages.";
+    static const char* h1_prefixed = " Each string is preceded by the little-endian 32-bit index of its entry in the tables\n"
+                                     "// below.\n";
+    static const char* h1_tail_merged = " Strings that are suffixes of longer strings are stored as the tail of the longer\n"
+                                        "// string, and entries are numbered in blob order.\n";
 
-    std::fwrite(h1, 1, strlen(h1), fp_);
+    out_ += h1;
+    switch (options_.order)
+    {
+    case StringOrder::references:
+        out_ += h1_references;
+        break;
+    case StringOrder::source:
+        out_ += h1_source;
+        break;
+    case StringOrder::profile:
+        out_ += h1_profile;
+        break;
+    }
+    out_ += options_.tail_merging ? h1_tail_merged : h1_prefixed;
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const char spool_blob_[] = {\n";
 
-    Statement query = db_.prepare("SELECT ROWID, string, ref_count FROM strings ORDER BY ROWID ASC");
-    int cursor = 0;
-    while (auto result = query.step<int, std::string, int>())
+    // The store lists the most referenced strings first
+    std::vector<std::pair<int, std::string>> live;
+    store_.for_each_string([&](int id, std::string_view str) { live.emplace_back(id, unescape(str)); });
+    order_strings(live);
+
+    // Strings are deduplicated by the bytes they denote, so differently escaped spellings share an entry. The
+    // strings are kept in order of first appearance until their entries are numbered.
+    std::unordered_map<std::string, uint32_t> entries;
+    std::vector<const std::string*> strings;
+    for (auto& [id, str] : live)
     {
-        auto&& [id, str, ref_count] = *result;
-        // SQL rows are 1-indexed
-        id = id - 1;
-        while (id > cursor)
+        auto [entry, inserted] = entries.emplace(std::move(str), static_cast<uint32_t>(strings.size()));
+        if (inserted)
         {
-            fwrite("\"\",", 1, 2, fp_);
-            ++cursor;
+            strings.emplace_back(&entry->first);
         }
+        fs_index_[id] = entry->second;
+    }
 
-        if (ref_count == 0)
+    std::vector<uint32_t> hosts;
+    if (options_.tail_merging)
+    {
+        hosts = suffix_hosts(strings);
+    }
+    else
+    {
+        hosts.resize(strings.size());
+        for (uint32_t i = 0; i != hosts.size(); ++i)
         {
-            fwrite("\"\",", 1, 2, fp_);
+            hosts[i] = i;
         }
-        else
+    }
+
+    // Each host is placed where the first of its strings would have been, and the strings it hosts end with it
+    size_t prefix_size = options_.tail_merging ? 0 : 4;
+    std::vector<size_t> offsets(strings.size(), SIZE_MAX);
+    std::vector<uint32_t> placed;
+    size_t blob_size = 0;
+    for (uint32_t i = 0; i != strings.size(); ++i)
+    {
+        uint32_t host = hosts[i];
+        if (offsets[host] == SIZE_MAX)
         {
-            std::fputc('"', fp_);
-            std::fwrite(str.data(), 1, str.size(), fp_);
-            std::fputs("\",", fp_);
+            offsets[host] = blob_size + prefix_size;
+            blob_size += prefix_size + strings[host]->size() + 1;
+            placed.emplace_back(host);
+        }
+        offsets[i] = offsets[host] + strings[host]->size() - strings[i]->size();
+
+        blob_stats_.size_without_merging += 4 + strings[i]->size() + 1;
+    }
+    blob_stats_.strings = strings.size();
+    blob_stats_.merged_strings = strings.size() - placed.size();
+    blob_stats_.size = blob_size;
+
+    // Number the entries. Without prefixes to read the index from, spool_index finds it by its offset, so the entries
+    // are numbered in blob order.
+    std::vector<uint32_t> by_index(strings.size());
+    for (uint32_t i = 0; i != by_index.size(); ++i)
+    {
+        by_index[i] = i;
+    }
+    if (options_.tail_merging)
+    {
+        std::sort(by_index.begin(), by_index.end(), [&](uint32_t lhs, uint32_t rhs) {
+            return offsets[lhs] < offsets[rhs];
+        });
+    }
+    std::vector<uint32_t> index_of(strings.size());
+    for (uint32_t index = 0; index != by_index.size(); ++index)
+    {
+        index_of[by_index[index]] = index;
+    }
+    for (auto& [id, entry] : fs_index_)
+    {
+        entry = static_cast<int>(index_of[entry]);
+    }
+
+    for (auto host : placed)
+    {
+        if (!options_.tail_merging)
+        {
+            uint32_t index = index_of[host];
+            char prefix[4] = {static_cast<char>(index & 0xff),
+                              static_cast<char>((index >> 8) & 0xff),
+                              static_cast<char>((index >> 16) & 0xff),
+                              static_cast<char>(index >> 24)};
+            append_chars({prefix, sizeof(prefix)}, out_);
+        }
+        append_chars(*strings[host], out_);
+        append_chars({"", 1}, out_);
+        out_ += '\n';
+    }
+
+    std::string fs_offsets;
+    std::string lengths;
+    std::string hashes;
+    // SPH finds strings by their hash alone, so distinct strings sharing one would be confused
+    std::unordered_map<uint64_t, const std::string*> by_hash;
+    for (auto entry : by_index)
+    {
+        uint64_t hash = hash_string(*strings[entry]);
+        auto [it, inserted] = by_hash.emplace(hash, strings[entry]);
+        if (!inserted)
+        {
+            fprintf(stderr,
+                    "Failed to generate the spool: \"%s\" and \"%s\" share the hash %016llx\n",
+                    it->second->c_str(),
+                    strings[entry]->c_str(),
+                    static_cast<unsigned long long>(hash));
+            throw std::runtime_error("Hash collision between pooled strings");
+        }
+
+        fs_offsets += "spool_blob_ + ";
+        fs_offsets += std::to_string(offsets[entry]);
+        fs_offsets += ",\n";
+        blob_offsets_.emplace_back(offsets[entry]);
+
+        lengths += std::to_string(strings[entry]->size());
+        lengths += ',';
+        entry_hashes_.emplace_back(hash);
+        hashes += std::to_string(entry_hashes_.back());
+        hashes += "ull,";
+    }
+
+    if (strings.empty())
+    {
+        append_chars({"", 1}, out_);
+        fs_offsets = "nullptr";
+        lengths = "0";
+        hashes = "0";
+    }
+
+    out_ += "};\n\n";
+
+    out_ += "// Number of entries and the blob offset of each, for spool::id\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_count_ = ";
+    out_ += std::to_string(blob_offsets_.size());
+    out_ += ";\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_offsets_[] = {\n";
+    for (auto offset : blob_offsets_)
+    {
+        out_ += std::to_string(offset);
+        out_ += ',';
+    }
+    if (blob_offsets_.empty())
+    {
+        out_ += '0';
+    }
+    out_ += "\n};\n\n";
+
+    out_ += "// Length of each entry, for spool_len\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_lengths_[] = {\n";
+    out_ += lengths;
+    out_ += "\n};\n\n";
+    out_ += "// 64-bit FNV-1a hash of each entry, for spool_hash\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint64_t spool_hashes_[] = {\n";
+    out_ += hashes;
+    out_ += "\n};\n\n";
+
+    write_lookup();
+
+    if (options_.offset_tables)
+    {
+        // Uses refer to the blob directly, so no pointer table is needed
+        return;
+    }
+
+    out_ += "// fs = flattened strings\nstatic const char* fs[] = {\n";
+    out_ += fs_offsets;
+    out_ += "};\n\n";
+}
+
+// Must match spool_mix_hash in spool.h. FNV-1a hashes of similar strings share most of their high bits, so they are
+// mixed before being split into buckets.
+static uint64_t mph_mix(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Bucket and slot functions of the perfect hash, which must match spool_find in spool.h
+static uint32_t mph_bucket(uint64_t hash, uint32_t bucket_count)
+{
+    return static_cast<uint32_t>(((mph_mix(hash) >> 32) * bucket_count) >> 32);
+}
+
+static uint32_t mph_slot(uint64_t hash, uint32_t seed, uint32_t count)
+{
+    uint64_t mixed = mph_mix(hash ^ (seed * 0x9e3779b97f4a7c15ull));
+    return static_cast<uint32_t>(((mixed & 0xffffffff) * count) >> 32);
+}
+
+void Generator::write_lookup()
+{
+    // Minimal perfect hash in the style of CHD (hash, displace and compress): entries are split into buckets of about
+    // four by hash, and buckets are placed largest first, each with the first seed that sends all of its entries to
+    // free slots. Every pooled string then has its own slot among exactly spool_count_ slots.
+    uint32_t count = static_cast<uint32_t>(entry_hashes_.size());
+    uint32_t bucket_count = count / 4 + 1;
+
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        buckets[mph_bucket(entry_hashes_[i], bucket_count)].emplace_back(i);
+    }
+
+    std::vector<uint32_t> order(bucket_count);
+    for (uint32_t i = 0; i != bucket_count; ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    std::vector<uint32_t> seeds(bucket_count, 0);
+    // One plus the entry index held by each slot
+    std::vector<uint32_t> slots(count, 0);
+    std::vector<uint32_t> placed;
+    for (uint32_t bucket : order)
+    {
+        const auto& entries = buckets[bucket];
+        if (entries.empty())
+        {
+            break;
+        }
+
+        for (uint32_t seed = 0;; ++seed)
+        {
+            if (seed == UINT32_MAX)
+            {
+                fprintf(stderr, "Failed to build the spool lookup table: no seed places bucket %u", bucket);
+                throw std::runtime_error("Failed to build lookup table");
+            }
+
+            placed.clear();
+            for (uint32_t entry : entries)
+            {
+                uint32_t slot = mph_slot(entry_hashes_[entry], seed, count);
+                if (slots[slot] != 0)
+                {
+                    break;
+                }
+                slots[slot] = entry + 1;
+                placed.emplace_back(slot);
+            }
+
+            if (placed.size() == entries.size())
+            {
+                seeds[bucket] = seed;
+                break;
+            }
+
+            for (uint32_t slot : placed)
+            {
+                slots[slot] = 0;
+            }
         }
-        ++cursor;
     }
-    query.reset();
-    std::fputs("\n};\n\n", fp_);
+
+    out_ += "// Minimal perfect hash over the entries for spool_find: the seed of each bucket of hashes, then the entry\n";
+    out_ += "// index held by each slot\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_bucket_count_ = ";
+    out_ += std::to_string(bucket_count);
+    out_ += ";\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_seeds_[] = {\n";
+    for (auto seed : seeds)
+    {
+        out_ += std::to_string(seed);
+        out_ += ',';
+    }
+    out_ += "\n};\n";
+    out_ += "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_slots_[] = {\n";
+    for (auto slot : slots)
+    {
+        out_ += std::to_string(slot - 1);
+        out_ += ',';
+    }
+    if (slots.empty())
+    {
+        out_ += '0';
+    }
+    out_ += "\n};\n\n";
 }
 
 void Generator::write_source_chunks()
@@ -55,31 +455,41 @@ void Generator::write_source_chunks()
         "// sc = source chunks \n"
         "static const char** sc[] = {\n";
 
-    std::fputs(h2, fp_);
-    Statement query = db_.prepare("SELECT path_id, id FROM flat_offsets ORDER BY path_id, ROWID ASC");
+    static const char* h2_offsets =
+        "\n"
+        "// Blob offsets of every use of the spool macro, grouped by source\n"
+        "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_uses_[] = {\n";
 
-    int last_path_id = -1;
+    out_ += options_.offset_tables ? h2_offsets : h2;
     int cursor = 0;
 
-    while (auto result = query.step<int, int>())
-    {
-        auto&& [path_id, id] = *result;
-        if (path_id != last_path_id)
+    store_.for_each_use([&](int path_id, int id) {
+        // Sources without any literals have no rows, but still need an entry so later sources keep their index
+        while (static_cast<int>(offsets_.size()) <= path_id)
         {
             offsets_.emplace_back(cursor);
         }
 
-        std::fputs("fs + ", fp_);
-        // Don't forget, SQL rows are 1-indexed
-        std::fputs(std::to_string(id - 1).c_str(), fp_);
-        std::fputc(',', fp_);
+        if (options_.offset_tables)
+        {
+            out_ += std::to_string(blob_offsets_[fs_index_[id]]);
+        }
+        else
+        {
+            out_ += "fs + ";
+            out_ += std::to_string(fs_index_[id]);
+        }
+        out_ += ',';
 
         ++cursor;
-        last_path_id = path_id;
+    });
+
+    if (cursor == 0)
+    {
+        out_ += options_.offset_tables ? "0" : "nullptr";
     }
-    query.reset();
 
-    std::fputs("\n};\n\n", fp_);
+    out_ += "\n};\n\n";
 }
 
 void Generator::write_offsets()
@@ -87,16 +497,29 @@ void Generator::write_offsets()
     static const char* h3 =
         "\n"
         "// The final boss\n"
-        "const char*** spool_strings_[] = {\n";
+        "SPOOL_EXPORT const char*** spool_strings_[] = {\n";
+
+    static const char* h3_offsets =
+        "\n"
+        "// Index of the first use of each source in spool_uses_\n"
+        "extern \"C\" SPOOL_EXPORT SPOOL_CONSTINIT const uint32_t spool_sources_[] = {\n";
 
-    std::fputs(h3, fp_);
+    out_ += options_.offset_tables ? h3_offsets : h3;
 
     for (auto offset : offsets_)
     {
-        std::fputs("sc + ", fp_);
-        std::fputs(std::to_string(offset).c_str(), fp_);
-        std::fputc(',', fp_);
+        if (!options_.offset_tables)
+        {
+            out_ += "sc + ";
+        }
+        out_ += std::to_string(offset);
+        out_ += ',';
+    }
+
+    if (offsets_.empty())
+    {
+        out_ += options_.offset_tables ? "0" : "nullptr";
     }
 
-    std::fputs("\n};\n", fp_);
+    out_ += "\n};\n";
 }
@@ -1,22 +1,81 @@
 #pragma once
 
-#include "Statement.hpp"
-#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-class Database;
+class Store;
+
+// Order of the strings in the blob, which decides the strings that share cache lines and pages
+enum class StringOrder
+{
+    // Most referenced first
+    references,
+    // In order of first use, so the strings of each source are stored together
+    source,
+    // Most used first according to the runtime profile in the store, then most referenced first
+    profile,
+};
+
+struct GeneratorOptions
+{
+    // Emit 32-bit offsets relative to the string blob instead of pointer tables. Must match SPOOL_OFFSET_TABLES in
+    // spool.h for every source of the spool.
+    bool offset_tables = false;
+    // Store strings that are suffixes of longer strings as the tail of those. Must match SPOOL_TAIL_MERGING in
+    // spool.h for every source of the spool.
+    bool tail_merging = false;
+    StringOrder order = StringOrder::references;
+};
+
+// Size of the string blob, to report what tail merging saves
+struct BlobStats
+{
+    size_t strings = 0;
+    // Strings stored as the tail of another
+    size_t merged_strings = 0;
+    size_t size = 0;
+    // Size of the blob with every string stored separately, each preceded by its index
+    size_t size_without_merging = 0;
+};
+
 class Generator
 {
 public:
-    Generator(Database& db, std::FILE* fp);
+    Generator(Store& store, const GeneratorOptions& options);
 
     void write_strings();
     void write_source_chunks();
     void write_offsets();
 
+    // The generated source is accumulated in memory so it can be compared with what is already on disk
+    [[nodiscard]] const std::string& output() const noexcept
+    {
+        return out_;
+    }
+
+    [[nodiscard]] const BlobStats& blob_stats() const noexcept
+    {
+        return blob_stats_;
+    }
+
 private:
-    Database& db_;
-    std::FILE* fp_;
+    // Sorts (id, unescaped string) pairs listed most referenced first into the order of the options
+    void order_strings(std::vector<std::pair<int, std::string>>& live);
+    void write_lookup();
+
+    Store& store_;
+    GeneratorOptions options_;
+    std::string out_;
+    BlobStats blob_stats_;
+    // Index into the emitted fs array for each live string id
+    std::unordered_map<int, int> fs_index_;
+    // Offset into the blob of each entry of fs
+    std::vector<size_t> blob_offsets_;
+    // Hash of each entry of fs
+    std::vector<uint64_t> entry_hashes_;
     std::vector<int> offsets_;
 };
 
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a. Not the fastest hash around, but it is trivially constexpr and stable across platforms, so hashes
+// may be persisted in the spool database.
+constexpr uint64_t hash_offset = 0xcbf29ce484222325ull;
+
+constexpr uint64_t hash_bytes(const char* data, size_t size, uint64_t hash = hash_offset)
+{
+    for (size_t i = 0; i != size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t hash_string(std::string_view str, uint64_t hash = hash_offset)
+{
+    return hash_bytes(str.data(), str.size(), hash);
+}
@@ -0,0 +1,77 @@
+#include "Launcher.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Returns the value of a SPOOL_ID definition, or -1 for any other definition
+static int spool_id(const char* definition)
+{
+    static const char name[] = "SPOOL_ID=";
+    if (std::strncmp(definition, name, sizeof(name) - 1) != 0)
+    {
+        return -1;
+    }
+    return std::atoi(definition + sizeof(name) - 1);
+}
+
+static bool is_flag(const char* arg, const char* flag)
+{
+    // MSVC accepts both - and / as the flag prefix
+    return (arg[0] == '-' || arg[0] == '/') && std::strcmp(arg + 1, flag) == 0;
+}
+
+CompileCommand parse_compile_command(int argc, char** argv)
+{
+    CompileCommand command;
+    bool several_sources = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if ((arg[0] == '-' || arg[0] == '/') && arg[1] == 'D')
+        {
+            // Either -DSPOOL_ID=n or -D SPOOL_ID=n
+            const char* definition = arg[2] != '\0' ? arg + 2 : (i + 1 < argc ? argv[++i] : "");
+            int id = spool_id(definition);
+            if (id != -1)
+            {
+                command.source_id = id;
+            }
+        }
+        else if (is_flag(arg, "c") && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            // CMake always passes the source right after -c
+            several_sources = command.source != nullptr;
+            command.source = argv[++i];
+        }
+    }
+
+    if (several_sources)
+    {
+        command.source = nullptr;
+    }
+    return command;
+}
+
+int run_compiler(char** argv)
+{
+    std::fflush(stdout);
+    std::fflush(stderr);
+#ifdef _WIN32
+    intptr_t result = _spawnvp(_P_WAIT, argv[0], argv);
+    if (result != -1)
+    {
+        return static_cast<int>(result);
+    }
+#else
+    execvp(argv[0], argv);
+#endif
+    fprintf(stderr, "Failed to run compiler: %s", argv[0]);
+    return 127;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Support for `spooler cc`, which runs as a compiler launcher (CMAKE_CXX_COMPILER_LAUNCHER) in front of every compile
+// job of a spooled target
+
+// What a compiler command line says about spooling, as set up by Spool.cmake
+struct CompileCommand
+{
+    // Source being compiled, or null if there isn't exactly one
+    const char* source = nullptr;
+    // Value of the SPOOL_ID definition, or -1 if the source isn't spooled
+    int source_id = -1;
+};
+
+CompileCommand parse_compile_command(int argc, char** argv);
+
+// Runs a null-terminated compiler command line in place of this process where possible. Returns the exit code of the
+// compiler, or 127 if it couldn't be run.
+int run_compiler(char** argv);
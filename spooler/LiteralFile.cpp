@@ -0,0 +1,83 @@
+#include "LiteralFile.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static const char magic[4] = {'S', 'P', 'L', '1'};
+
+bool write_literal_file(const char* path, const std::vector<std::string_view>& literals)
+{
+    std::string contents{magic, sizeof(magic)};
+    uint32_t count = static_cast<uint32_t>(literals.size());
+    contents.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (auto& literal : literals)
+    {
+        uint32_t size = static_cast<uint32_t>(literal.size());
+        contents.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        contents.append(literal);
+    }
+
+    // Leave the file (and its timestamp) alone if the literals are unchanged
+    MappedFile existing;
+    if (std::ifstream{path} && existing.open(path) && existing.view() == contents)
+    {
+        return true;
+    }
+    existing.close();
+
+    std::FILE* fp = std::fopen(path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Failed to open file for writing: %s", path);
+        return false;
+    }
+
+    std::fwrite(contents.data(), 1, contents.size(), fp);
+    bool ok = std::ferror(fp) == 0;
+    ok = std::fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write file: %s", path);
+    }
+    return ok;
+}
+
+bool read_literal_file(std::string_view contents, std::vector<std::string_view>& literals)
+{
+    literals.clear();
+
+    const char* cursor = contents.data();
+    const char* end = cursor + contents.size();
+    uint32_t count;
+    if (contents.size() < sizeof(magic) + sizeof(count) || std::memcmp(cursor, magic, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+    std::memcpy(&count, cursor + sizeof(magic), sizeof(count));
+    cursor += sizeof(magic) + sizeof(count);
+
+    literals.reserve(count);
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        uint32_t size;
+        if (static_cast<size_t>(end - cursor) < sizeof(size))
+        {
+            return false;
+        }
+        std::memcpy(&size, cursor, sizeof(size));
+        cursor += sizeof(size);
+
+        if (static_cast<size_t>(end - cursor) < size)
+        {
+            return false;
+        }
+        literals.emplace_back(cursor, size);
+        cursor += size;
+    }
+
+    return cursor == end;
+}
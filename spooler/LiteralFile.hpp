@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+// Literal files hold the ordered literals parsed from a single source file. They are written by `spooler parse`
+// (which never touches the database and may run in parallel) and consumed by `spooler merge`.
+//
+// Layout: the 4 byte magic "SPL1", a 32-bit literal count, and then for each literal its 32-bit length followed by
+// its bytes. Integers are stored in native byte order as the files never leave the build tree.
+
+// Returns false if the file could not be written
+bool write_literal_file(const char* path, const std::vector<std::string_view>& literals);
+
+// Decodes the contents of a literal file (typically a MappedFile) into views of those contents. Returns false if the
+// contents are malformed.
+bool read_literal_file(std::string_view contents, std::vector<std::string_view>& literals);
@@ -1,148 +1,697 @@
-#include "Database.hpp"
+#include "Changes.hpp"
+#include "Daemon.hpp"
 #include "Generator.hpp"
-#include "Origins.hpp"
+#include "Launcher.hpp"
+#include "LiteralFile.hpp"
+#include "MappedFile.hpp"
 #include "Parser.hpp"
-#include "Strings.hpp"
+#include "Stats.hpp"
+#include "Store.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <sqlite3.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 void print_help()
 {
     printf(
         "Usage:\n"
-        "spooler [command] [path to db] [path to file] [macro name]\n"
+        "spooler [command] [path to db] [path to file] [macro name] [source id]\n"
+        "spooler analyze-batch [path to db] [macro name] [path to file list] [path to stamp]\n"
+        "spooler parse [path to file] [macro name] [path to literal file]\n"
+        "spooler merge [path to db] [path to literal file list] [path to stamp]\n"
+        "spooler add [path to db] [path to literal file] [source id]\n"
+        "spooler generate [path to db] [path to output source] [--offsets] [--tail-merge] [--order=refs|source|profile]\n"
+        "                 [--compact-above=ratio]\n"
+        "spooler profile [path to db] [path to profile...]\n"
+        "spooler compact [path to db]\n"
+        "spooler serve [path to socket]\n"
+        "spooler cc [path to db] [macro name] [compiler command...]\n"
+        "spooler cc [path to db] --generate [--headers=list] [--macro=name] [generate options...]\n"
+        "           [compiler command...]\n"
         "\n"
         "where [command] is one of:\n"
         "  - analyze: Given a database and a file, extract literal dependencies for pooling later\n"
+        "  - analyze-batch: Like analyze, but for every file in a list of \"[source id] [path]\" lines at once\n"
+        "  - parse: Extract the literals of a single file into a literal file without accessing any database\n"
+        "  - merge: Apply a list of \"[source id] [path to literal file]\" lines produced by parse to the database\n"
+        "  - add: Apply the literal file of a single source produced by parse to the database\n"
         "  - generate: Given a database of strings, emit the finalized spool sources\n"
+        "  - profile: Replace the runtime access profile of a database with the sum of the given profiles, written by\n"
+        "    spool::write_profile from runs of sources compiled with SPOOL_PROFILE\n"
+        "  - compact: Renumber the strings in use densely and reclaim the space of removed strings\n"
+        "  - serve: Keep databases in memory and run the other commands for spooler invocations that connect to it\n"
+        "  - cc: Compiler launcher that analyzes the source being compiled (if it defines SPOOL_ID), or generates it\n"
+        "    with --generate, and then runs the compiler. With --headers, generating first analyzes the headers in the\n"
+        "    given \"[source id] [path]\" list for the macro given by --macro (SP by default)\n"
         "\n"
         "The final macro name argument is used to customize how pooled string literals should be denoted\n"
+        "\n"
+        "Passing --offsets to generate emits relocation-free offset tables for use with SPOOL_OFFSET_TABLES.\n"
+        "Passing --tail-merge stores strings that are suffixes of longer strings inside those, for use with\n"
+        "SPOOL_TAIL_MERGING.\n"
+        "Passing --order to generate decides which strings are stored next to each other: the most referenced first\n"
+        "(refs, the default), in order of first use by the sources (source), or the most used by the profile given to\n"
+        "the profile command first (profile).\n"
+        "Passing --compact-above to generate first compacts the database if the ids of removed strings make up more\n"
+        "than the given fraction of all ids, or removed strings and superseded literals more than that fraction of\n"
+        "its size.\n"
+        "\n"
+        "Sources whose literals hash the same as when they were last spooled are skipped. The optional stamp file is\n"
+        "only touched when the database changed.\n"
+        "\n"
+        "Passing --stats to any command but serve and cc prints the wall time of each phase of the command (reading,\n"
+        "parsing, waiting for the database lock, queries, generating) and counts of the bytes scanned, literals and\n"
+        "rows read and written per table. Passing --stats=path appends them to path in the Chrome trace event format\n"
+        "instead, so the commands of a build accumulate in one trace. SPOOLER_STATS sets the same for every command\n"
+        "that doesn't pass --stats, including those run by cc, with - meaning stdout.\n"
+        "\n"
+        "Databases whose path ends in .db use SQLite. Any other path uses the native append-only format, which is\n"
+        "created on first use.\n"
+        "\n"
+        "Commands that use a database are run by a spooler serving on the socket named by SPOOLER_SOCKET (by default\n"
+        "spooler.sock in XDG_RUNTIME_DIR, or /tmp) when there is one, and in-process otherwise. Set SPOOLER_SOCKET to an\n"
+        "empty string to always run in-process.\n"
         "\n");
 }
 
-int finalize(Database& db, const char* file_path, const char* macro_name)
+int finalize(Store& store, const char* file_path, const GeneratorOptions& options)
 {
-    std::FILE* fp = std::fopen(file_path, "wb");
+    // Generation only reads, so it runs alongside merges into the same spool
+    store.begin_read();
+    Generator generator{store, options};
+    {
+        StatsPhase phase{"generate"};
+        generator.write_strings();
+        generator.write_source_chunks();
+        generator.write_offsets();
+    }
+    store.end_read();
+    const std::string& output = generator.output();
+    stats_count("bytes generated", output.size());
+
+    if (options.tail_merging)
+    {
+        const BlobStats& stats = generator.blob_stats();
+        printf("Tail merging stored %zu of %zu strings inside longer ones, shrinking the blob from %zu to %zu bytes\n",
+               stats.merged_strings, stats.strings, stats.size_without_merging, stats.size);
+    }
+
+    StatsPhase phase{"output"};
+
+    // Leave the existing source (and its timestamp) alone if nothing changed so the spool isn't recompiled
+    {
+        MappedFile existing;
+        if (std::ifstream{file_path} && existing.open(file_path) && existing.view() == output)
+        {
+            return 0;
+        }
+    }
+
+    // Write to a temporary file first so the source is replaced atomically
+    std::string tmp_path = std::string{file_path} + ".tmp";
+    std::FILE* fp = std::fopen(tmp_path.c_str(), "wb");
     if (!fp)
     {
-        fprintf(stderr, "Failed to open file for writing: %s", file_path);
+        fprintf(stderr, "Failed to open file for writing: %s", tmp_path.c_str());
         return 1;
     }
 
-    db.lock();
-    Generator generator{db, fp};
-    generator.write_strings();
-    generator.write_source_chunks();
-    generator.write_offsets();
+    std::fwrite(output.data(), 1, output.size(), fp);
+    bool ok = std::ferror(fp) == 0;
+    ok = std::fclose(fp) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+    {
+        std::filesystem::rename(tmp_path, file_path, error);
+    }
+    if (!ok || error)
+    {
+        fprintf(stderr, "Failed to write file: %s", file_path);
+        std::filesystem::remove(tmp_path, error);
+        return 1;
+    }
 
     return 0;
 }
 
-int analyze(Database& db, const char* file_path, int source_id, const char* macro_name)
+// Maps and parses the source file at file_path, handing its literals to `use` while the mapping is still alive.
+// Returns false if the file could not be opened.
+template <typename Use> bool with_source_literals(const char* file_path, const char* macro_name, Use&& use)
 {
-    std::FILE* fp = std::fopen(file_path, "rb");
-    if (!fp)
+    // Pages of the mapping are read as they are first touched, so most of the reading is timed as part of parsing
+    MappedFile file;
+    {
+        StatsPhase phase{"read"};
+        if (!file.open(file_path))
+        {
+            return false;
+        }
+    }
+
+    Parser parser(file.data(), file.size(), macro_name);
+    {
+        StatsPhase phase{"parse"};
+        parser.parse();
+    }
+    stats_count("files", 1);
+    stats_count("bytes scanned", file.size());
+    stats_count("literals", parser.literals().size());
+    use(parser.literals());
+    return true;
+}
+
+// Maps the literal file at file_path, handing its literals to `use`. Returns false if the file could not be read.
+template <typename Use> bool with_file_literals(const char* file_path, Use&& use)
+{
+    MappedFile file;
+    std::vector<std::string_view> literals;
+    {
+        StatsPhase phase{"read"};
+        if (!file.open(file_path))
+        {
+            return false;
+        }
+
+        if (!read_literal_file(file.view(), literals))
+        {
+            fprintf(stderr, "Malformed literal file: %s", file_path);
+            return false;
+        }
+    }
+    stats_count("literal files", 1);
+    stats_count("bytes read", file.size());
+    stats_count("literals", literals.size());
+    use(literals);
+    return true;
+}
+
+int analyze(Store& store, const char* file_path, int source_id, const char* macro_name)
+{
+    Changes changes(store);
+    bool found = with_source_literals(file_path, macro_name, [&](const std::vector<std::string_view>& literals) {
+        changes.add(source_id, literals);
+    });
+    if (!found)
     {
-        fprintf(stderr, "Failed to open file for reading: %s", file_path);
         return 1;
     }
+    changes.commit();
 
-    // Query file size
-    std::fseek(fp, 0, SEEK_END);
-    size_t size = std::ftell(fp);
-    std::fseek(fp, 0, SEEK_SET);
-    // Read all contents (employ `new` so as to avoid the hassle of initiailizing memory we're about to overwrite)
-    char* contents = new char[size + 2];
-    std::fread(contents + 1, 1, size, fp);
-    // Pad both sides with null bytes for convenient parsing
-    contents[0] = '\0';
-    contents[size + 1] = '\0';
-    printf("%s", contents);
+    return 0;
+}
 
-    Parser parser(contents, size + 2, macro_name);
-    parser.parse();
+int add(Store& store, const char* literal_path, int source_id)
+{
+    Changes changes(store);
+    bool found = with_file_literals(literal_path, [&](const std::vector<std::string_view>& literals) {
+        changes.add(source_id, literals);
+    });
+    if (!found)
+    {
+        return 1;
+    }
+    changes.commit();
 
-    delete[] contents;
+    return 0;
+}
 
-    db.lock();
-    Origins origins(db, source_id);
-    origins.select();
-    // Copy here is intentional
-    auto& counts = origins.ref_counts();
-    std::unordered_map<int, int> new_counts;
+// Applies the literals of every entry in list_path to the database within a single write transaction. Each line of the
+// list file holds a source id followed by a space and a path. `load` is invoked with each path and a callback that
+// must receive the ordered literals of that path. If given, the stamp file is touched only when something changed
+// (or it doesn't exist yet) so that build systems which restat outputs can skip regenerating the spool.
+template <typename Load> int apply_list(Store& store, const char* list_path, const char* stamp_path, Load&& load)
+{
+    std::ifstream list{list_path};
+    if (!list)
+    {
+        fprintf(stderr, "Failed to open file list for reading: %s", list_path);
+        return 1;
+    }
 
-    Strings strings(db);
+    // The literals of all changed files are reconciled with the database at once, in a single write transaction
+    Changes changes(store);
 
-    for (auto& [id, ref_count] : counts)
+    int total = 0;
+    std::string line;
+    while (std::getline(list, line))
     {
-        strings.lookup_id(id);
-        strings.dec_by(id, ref_count);
+        size_t split = line.find(' ');
+        if (split == std::string::npos)
+        {
+            continue;
+        }
+
+        int source_id = std::stoi(line.substr(0, split));
+        std::string path = line.substr(split + 1);
+
+        bool loaded = load(path.c_str(), [&](const std::vector<std::string_view>& literals) {
+            changes.add(source_id, literals);
+        });
+        if (!loaded)
+        {
+            return 1;
+        }
+        ++total;
     }
 
-    std::vector<int> ids;
+    size_t changed = changes.commit();
+
+    printf("Spooled %d files (%zu changed)\n", total, changed);
 
-    for (auto& str : parser.literals())
+    if (stamp_path && (changed != 0 || !std::ifstream{stamp_path}))
     {
-        // Fetch existing ref counts or initialize
-        auto id = strings.id(str);
-        strings.inc(id);
-        ids.emplace_back(id);
-        ++new_counts[id];
+        if (!std::ofstream{stamp_path})
+        {
+            fprintf(stderr, "Failed to open file for writing: %s", stamp_path);
+            return 1;
+        }
     }
+    return 0;
+}
+
+int analyze_batch(Store& store, const char* list_path, const char* macro_name, const char* stamp_path)
+{
+    return apply_list(store, list_path, stamp_path, [macro_name](const char* path, auto&& use) {
+        return with_source_literals(path, macro_name, use);
+    });
+}
 
-    strings.commit();
-    origins.commit_new(new_counts);
+// Parses a single source file without touching the database, leaving the results in a literal file for `merge`
+int parse(const char* file_path, const char* macro_name, const char* out_path)
+{
+    bool written = false;
+    bool found = with_source_literals(file_path, macro_name, [&](const std::vector<std::string_view>& literals) {
+        written = write_literal_file(out_path, literals);
+    });
 
-    Statement nuke_old = db.prepare("DELETE FROM flat_offsets WHERE path_id = ?;");
-    nuke_old.bind(1, source_id);
-    nuke_old.step();
-    nuke_old.reset();
+    return found && written ? 0 : 1;
+}
 
-    Statement inserter = db.prepare("INSERT INTO flat_offsets (path_id, id) VALUES (?, ?);");
-    for (auto id : ids)
+int merge(Store& store, const char* list_path, const char* stamp_path)
+{
+    return apply_list(store, list_path, stamp_path, [](const char* path, auto&& use) { return with_file_literals(path, use); });
+}
+
+// Reads profiles of "[16 hex digit hash] [count]" lines and replaces the profile of the store with their sum
+int profile(Store& store, int count, char** paths)
+{
+    std::unordered_map<uint64_t, uint64_t> counts;
+    for (int i = 0; i != count; ++i)
     {
-        inserter.bind(1, source_id);
-        inserter.bind(2, id);
-        inserter.step();
-        inserter.reset();
+        std::ifstream file{paths[i]};
+        if (!file)
+        {
+            fprintf(stderr, "Failed to open profile: %s", paths[i]);
+            return 1;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            unsigned long long hash;
+            unsigned long long uses;
+            if (std::sscanf(line.c_str(), "%llx %llu", &hash, &uses) != 2)
+            {
+                fprintf(stderr, "Malformed line in profile %s: %s", paths[i], line.c_str());
+                return 1;
+            }
+            counts[hash] += uses;
+        }
     }
 
+    store.write_profile(counts);
+    printf("Profiled %zu strings\n", counts.size());
     return 0;
 }
 
-int main(int argc, char** argv)
+// Stores smaller than this are never worth compacting for their size alone
+static constexpr size_t min_compact_size = 64 * 1024;
+
+// Compacts the store if the ids of removed strings make up more than max_waste_ratio of its ids, or the space compacting
+// would reclaim more than max_waste_ratio of its size, or always if max_waste_ratio is negative
+int compact(Store& store, double max_waste_ratio)
 {
-    if (argc == 1)
+    StoreUsage usage = store.usage();
+    size_t holes = usage.id_space - usage.live_ids;
+    size_t waste = usage.size - std::min(usage.live_size, usage.size);
+    if (max_waste_ratio >= 0 && static_cast<double>(holes) <= max_waste_ratio * static_cast<double>(usage.id_space)
+        && (usage.size < min_compact_size
+            || static_cast<double>(waste) <= max_waste_ratio * static_cast<double>(usage.size)))
     {
-        print_help();
         return 0;
     }
 
-    const char* db_path = argv[2];
-    const char* file_path = argv[3];
-    const char* macro_name = argv[4];
-
-    // Open database connection
-    Database db{db_path};
+    store.compact();
+    printf("Compacted the spool from %zu to %zu string ids (%zu to about %zu bytes)\n", usage.id_space, usage.live_ids,
+           usage.size, usage.live_size);
+    return 0;
+}
 
-    int result;
+// Runs a command that uses the store at argv[2]
+int run(Store& store, int argc, char** argv)
+{
+    int result = 1;
 
     if (strcmp(argv[1], "generate") == 0)
     {
-        result = finalize(db, file_path, macro_name);
+        GeneratorOptions options;
+        double max_waste_ratio = -1;
+        for (int i = 4; i < argc; ++i)
+        {
+            if (strcmp(argv[i], "--offsets") == 0)
+            {
+                options.offset_tables = true;
+            }
+            else if (strcmp(argv[i], "--tail-merge") == 0)
+            {
+                options.tail_merging = true;
+            }
+            else if (strcmp(argv[i], "--order=refs") == 0)
+            {
+                options.order = StringOrder::references;
+            }
+            else if (strcmp(argv[i], "--order=source") == 0)
+            {
+                options.order = StringOrder::source;
+            }
+            else if (strcmp(argv[i], "--order=profile") == 0)
+            {
+                options.order = StringOrder::profile;
+            }
+            else if (strncmp(argv[i], "--compact-above=", 16) == 0)
+            {
+                max_waste_ratio = std::strtod(argv[i] + 16, nullptr);
+            }
+            else
+            {
+                fprintf(stderr, "Unrecognized generate option: %s", argv[i]);
+                return 1;
+            }
+        }
+        if (max_waste_ratio >= 0)
+        {
+            // Ids never appear in the generated source, so compacting doesn't change it
+            compact(store, max_waste_ratio);
+        }
+        result = finalize(store, argv[3], options);
     }
-    else if (strcmp(argv[1], "analyze") == 0)
+    else if (strcmp(argv[1], "analyze") == 0 && argc > 5)
     {
         int source_id = std::stoi(argv[5]);
-        result = analyze(db, file_path, source_id, macro_name);
+        result = analyze(store, argv[3], source_id, argv[4]);
+    }
+    else if (strcmp(argv[1], "analyze-batch") == 0 && argc > 4)
+    {
+        result = analyze_batch(store, argv[4], argv[3], argc > 5 ? argv[5] : nullptr);
+    }
+    else if (strcmp(argv[1], "merge") == 0)
+    {
+        result = merge(store, argv[3], argc > 4 ? argv[4] : nullptr);
+    }
+    else if (strcmp(argv[1], "add") == 0 && argc > 4)
+    {
+        result = add(store, argv[3], std::stoi(argv[4]));
+    }
+    else if (strcmp(argv[1], "profile") == 0)
+    {
+        result = profile(store, argc - 3, argv + 3);
+    }
+    else if (strcmp(argv[1], "compact") == 0)
+    {
+        result = compact(store, -1);
     }
     else
     {
-        fprintf(stderr, "Unrecognized command: %s", argv[2]);
+        fprintf(stderr, "Unrecognized command: %s", argv[1]);
+    }
+
+    return result;
+}
+
+// True if there are enough arguments for a command that uses a store
+bool has_store_arguments(int argc, char** argv)
+{
+    // compact is the only command that takes nothing but the store
+    return argc >= 4 || (argc == 3 && strcmp(argv[1], "compact") == 0);
+}
+
+// Removes a --stats or --stats=path option from anywhere in the arguments, and returns where it reports to: "-" for
+// stdout, or a trace file. Empty if there is no such option.
+std::string take_stats_option(int& argc, char** argv)
+{
+    std::string output;
+    int kept = 0;
+    for (int i = 0; i != argc; ++i)
+    {
+        if (strcmp(argv[i], "--stats") == 0)
+        {
+            output = "-";
+        }
+        else if (strncmp(argv[i], "--stats=", 8) == 0)
+        {
+            output = argv[i] + 8;
+        }
+        else
+        {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    return output;
+}
+
+// Runs `command`, which runs the command in argv, and reports its stats to stats_output unless that is empty
+template <typename Command>
+int run_with_stats(const std::string& stats_output, int argc, char** argv, Command&& command)
+{
+    if (stats_output.empty())
+    {
+        return command();
     }
 
+    Stats stats{argc, argv};
+    int result = command();
+    if (!stats.report(stats_output))
+    {
+        // The command itself succeeded, so the build goes on without its stats
+        fprintf(stderr, "Failed to write stats: %s\n", stats_output.c_str());
+    }
     return result;
 }
+
+// Runs commands for connecting spoolers, keeping every store it opens in memory for the next command
+int serve_stores(const char* socket_path)
+{
+    std::unordered_map<std::string, std::unique_ptr<Store>> stores;
+
+    return serve(socket_path, [&](int argc, char** argv) {
+        // Clients pass on where to report stats as an option
+        std::string stats_output = take_stats_option(argc, argv);
+        if (!has_store_arguments(argc, argv))
+        {
+            fprintf(stderr, "Missing arguments to command: %s", argc > 1 ? argv[1] : "");
+            return 1;
+        }
+
+        // The daemon runs in the working directory of each client in turn
+        std::string path = std::filesystem::absolute(argv[2]).lexically_normal().string();
+        try
+        {
+            return run_with_stats(stats_output, argc, argv, [&] {
+                std::unique_ptr<Store>& store = stores[path];
+                if (!store)
+                {
+                    store = open_store(path.c_str());
+                }
+                return run(*store, argc, argv);
+            });
+        }
+        catch (const std::exception& e)
+        {
+            // Standard error is still the client's
+            fprintf(stderr, "%s\n", e.what());
+            // A failed command may have left the store in any state, so the next command opens it again
+            stores.erase(path);
+            return 1;
+        }
+    });
+}
+
+// Runs a command that uses the store at argv[2] in the daemon if there is one, and in-process otherwise, reporting its
+// stats to stats_output unless that is empty
+int dispatch(int argc, char** argv, const std::string& stats_output)
+{
+    // The daemon doesn't see the environment of the client, so stats are requested with an option
+    std::vector<char*> args{argv, argv + argc};
+    std::string stats_option = "--stats=" + stats_output;
+    if (!stats_output.empty())
+    {
+        args.emplace_back(stats_option.data());
+    }
+    args.emplace_back(nullptr);
+
+    int result = 1;
+    if (run_in_daemon(default_socket_path().c_str(), static_cast<int>(args.size() - 1), args.data(), result))
+    {
+        return result;
+    }
+
+    return run_with_stats(stats_output, argc, argv, [&] {
+        // Open the database, or create it if this is the first time the spool is used
+        std::unique_ptr<Store> store = open_store(argv[2]);
+        return run(*store, argc, argv);
+    });
+}
+
+// Spools the source of a compiler command within the compile job, which already reads the source, and then runs the
+// compiler. Spooled sources are analyzed into the store, and the spool source itself is generated right before it is
+// compiled. The stats of each command run before the compiler are reported to stats_output unless that is empty.
+int cc(int argc, char** argv, const std::string& stats_output)
+{
+    bool generate = argc > 3 && strcmp(argv[3], "--generate") == 0;
+    int first = 4;
+    while (generate && first < argc && strncmp(argv[first], "--", 2) == 0)
+    {
+        ++first;
+    }
+    if (argc <= first)
+    {
+        print_help();
+        return 1;
+    }
+
+    char** compiler = argv + first;
+    CompileCommand command = parse_compile_command(argc - first, compiler);
+
+    // Commands run before the compiler, in order, and the literal file they pass the literals of the source through
+    std::vector<std::vector<std::string>> commands;
+    std::string literal_path;
+    if (command.source && generate)
+    {
+        // Headers are never compiled by themselves, so the generating job analyzes the ones listed by --headers
+        std::vector<std::string> args = {argv[0], "generate", argv[2], command.source};
+        const char* headers = nullptr;
+        const char* macro_name = "SP";
+        for (int i = 4; i != first; ++i)
+        {
+            if (strncmp(argv[i], "--headers=", 10) == 0)
+            {
+                headers = argv[i] + 10;
+            }
+            else if (strncmp(argv[i], "--macro=", 8) == 0)
+            {
+                macro_name = argv[i] + 8;
+            }
+            else
+            {
+                args.emplace_back(argv[i]);
+            }
+        }
+        if (headers)
+        {
+            commands.push_back({argv[0], "analyze-batch", argv[2], macro_name, headers});
+        }
+        commands.emplace_back(std::move(args));
+    }
+    else if (command.source && command.source_id != -1)
+    {
+        // The compile job parses its source itself, so that jobs handing their work to a daemon, which runs one
+        // command at a time, only wait for each other to write the store
+        std::string source_id = std::to_string(command.source_id);
+        literal_path = std::string{argv[2]} + "." + source_id + ".literals";
+        commands.push_back({argv[0], "parse", command.source, argv[3], literal_path});
+        commands.push_back({argv[0], "add", argv[2], literal_path, source_id});
+    }
+
+    for (auto& args : commands)
+    {
+        std::vector<char*> args_argv;
+        for (auto& arg : args)
+        {
+            args_argv.emplace_back(arg.data());
+        }
+        args_argv.emplace_back(nullptr);
+
+        int args_argc = static_cast<int>(args.size());
+        int result = 0;
+        if (args[1] == "parse")
+        {
+            // Parsing doesn't need the store, so it never goes to the daemon
+            result = run_with_stats(stats_output, args_argc, args_argv.data(), [&] {
+                return parse(args_argv[2], args_argv[3], args_argv[4]);
+            });
+        }
+        else
+        {
+            result = dispatch(args_argc, args_argv.data(), stats_output);
+        }
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+
+    if (!literal_path.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove(literal_path, error);
+    }
+
+    return run_compiler(compiler);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "serve") == 0)
+    {
+        std::string socket_path = argc > 2 ? argv[2] : default_socket_path();
+        if (socket_path.empty())
+        {
+            fprintf(stderr, "No socket to serve on");
+            return 1;
+        }
+        return serve_stores(socket_path.c_str());
+    }
+
+    // Every argument after cc may belong to the compiler, so the compiler launcher only takes SPOOLER_STATS
+    const char* stats_env = std::getenv("SPOOLER_STATS");
+    if (argc > 1 && strcmp(argv[1], "cc") == 0)
+    {
+        return cc(argc, argv, stats_env ? stats_env : "");
+    }
+
+    std::string stats_output = take_stats_option(argc, argv);
+    if (stats_output.empty() && stats_env)
+    {
+        stats_output = stats_env;
+    }
+
+    if (!has_store_arguments(argc, argv))
+    {
+        print_help();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "parse") == 0)
+    {
+        // Parsing is the only command that doesn't need the database
+        if (argc < 5)
+        {
+            print_help();
+            return 1;
+        }
+        return run_with_stats(stats_output, argc, argv, [&] { return parse(argv[2], argv[3], argv[4]); });
+    }
+
+    return dispatch(argc, argv, stats_output);
+}
@@ -0,0 +1,126 @@
+#include "MappedFile.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    // Other processes may truncate or replace the file while it is mapped, as they can on POSIX
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "Failed to open file for reading: %s", path);
+        return false;
+    }
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        fprintf(stderr, "Failed to query file size: %s", path);
+        close();
+        return false;
+    }
+
+    if (size.QuadPart == 0)
+    {
+        // Empty files can't be mapped
+        return true;
+    }
+
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        fprintf(stderr, "Failed to map file: %s", path);
+        close();
+        return false;
+    }
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(size.QuadPart);
+    mapped_ = true;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Failed to open file for reading: %s", path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        fprintf(stderr, "Failed to query file size: %s", path);
+        ::close(fd);
+        return false;
+    }
+
+    if (info.st_size == 0)
+    {
+        // Empty files can't be mapped
+        ::close(fd);
+        return true;
+    }
+
+    void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map file: %s", path);
+        return false;
+    }
+    madvise(view, info.st_size, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(info.st_size);
+    mapped_ = true;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mapped_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_)
+    {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_)
+    {
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+#else
+    if (mapped_)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = "";
+    size_ = 0;
+    mapped_ = false;
+}
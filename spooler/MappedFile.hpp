@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Read-only view of an entire file mapped into memory. Contents are not null-terminated.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    ~MappedFile();
+
+    // Returns false if the file could not be opened or mapped
+    bool open(const char* path);
+    void close();
+
+    [[nodiscard]] const char* data() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] std::string_view view() const noexcept
+    {
+        return {data_, size_};
+    }
+
+private:
+    const char* data_ = "";
+    size_t size_ = 0;
+    bool mapped_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
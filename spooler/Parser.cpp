@@ -1,137 +1,516 @@
 #include "Parser.hpp"
+#include "Escape.hpp"
 
-#include <cassert>
 #include <cctype>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
+// The scanning loops below look for a handful of interesting characters (quotes, comment starts, backslashes and the
+// first character of the macro name) a full vector register at a time. Define SPOOL_SCAN_SCALAR to force the portable fallback.
+#if !defined(SPOOL_SCAN_SCALAR)
+#if defined(__AVX2__)
+#define SPOOL_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPOOL_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+static unsigned first_set_bit(unsigned mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Returns the first position in [first, last) holding any of the needles, or last if there is none (or first is past
+// last)
+template <typename... Chars> static const char* find_any(const char* first, const char* last, Chars... needles)
+{
+#if defined(SPOOL_SCAN_AVX2)
+    for (; last - first >= 32; first += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        __m256i hits = _mm256_setzero_si256();
+        ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(needles)))), ...);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0)
+        {
+            return first + first_set_bit(mask);
+        }
+    }
+#endif
+#if defined(SPOOL_SCAN_SSE2)
+    for (; last - first >= 16; first += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        __m128i hits = _mm_setzero_si128();
+        ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(needles)))), ...);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0)
+        {
+            return first + first_set_bit(mask);
+        }
+    }
+#endif
+    for (; first < last; ++first)
+    {
+        char x = *first;
+        if (((x == needles) || ...))
+        {
+            return first;
+        }
+    }
+    return last;
+}
+
+static bool is_identifier(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool is_space(char c)
+{
+    return isspace(static_cast<unsigned char>(c));
+}
+
+// Start of the identifier or number ending right before cursor
+static const char* token_start(const char* begin, const char* cursor)
+{
+    while (cursor != begin && is_identifier(cursor[-1]))
+    {
+        --cursor;
+    }
+    return cursor;
+}
+
+// Skips a backslash and the character it escapes, or a whole line splice with a CRLF line ending
+static const char* skip_backslash(const char* cursor, const char* end)
+{
+    if (end - cursor > 2 && cursor[1] == '\r' && cursor[2] == '\n')
+    {
+        return cursor + 3;
+    }
+    return cursor + 2;
+}
+
+static bool is_raw_prefix(std::string_view prefix)
+{
+    return prefix == "R" || prefix == "u8R" || prefix == "uR" || prefix == "UR" || prefix == "LR";
+}
+
+// Finds the body of the raw string literal whose opening quote is at quote, and the position past its closing quote.
+// Returns false if the delimiter is malformed.
+static bool scan_raw_string(const char* quote, const char* end, std::string_view& body, const char*& next)
+{
+    // The delimiter holds at most 16 characters, none of them spaces, backslashes or parentheses
+    const char* delimiter = quote + 1;
+    const char* open = delimiter;
+    while (open < end && *open != '(')
+    {
+        if (open - delimiter == 16 || is_space(*open) || *open == '\\' || *open == ')' || *open == '"')
+        {
+            return false;
+        }
+        ++open;
+    }
+    if (open == end)
+    {
+        return false;
+    }
+
+    // The body ends at the first ) followed by the delimiter and a quote, with no escapes or splices in between
+    size_t delimiter_size = static_cast<size_t>(open - delimiter);
+    for (const char* close = open + 1;; ++close)
+    {
+        close = find_any(close, end, ')');
+        if (static_cast<size_t>(end - close) < delimiter_size + 2)
+        {
+            body = {open + 1, static_cast<size_t>(end - open - 1)};
+            next = end;
+            return true;
+        }
+        if (std::memcmp(close + 1, delimiter, delimiter_size) == 0 && close[delimiter_size + 1] == '"')
+        {
+            body = {open + 1, static_cast<size_t>(close - open - 1)};
+            next = close + delimiter_size + 2;
+            return true;
+        }
+    }
+}
 
 Parser::Parser(const char* contents, size_t size, const char* macro_name)
     : contents_{contents, size}
     , macro_name_{macro_name}
 {
-    assert(contents[0] == '\0' && "contents must be null-padded at the start");
 }
 
 void Parser::parse()
 {
-    bool in_macro = false;
-    bool in_quote = false;
-
-    size_t i = 1;
-    std::string literal;
+    const char* begin = contents_.data();
+    const char* cursor = begin;
+    const char* end = contents_.data() + contents_.size();
+    const size_t macro_size = strlen(macro_name_);
+    const char macro_first = macro_name_[0];
 
     // This is not the way I'd build a parser in general, but is quite fast and suitable for the relatively
     // simple parsing grammar we need to accommodate (quoted strings in a user-defined macro, accounting for
-    // quote and escape sequences).
-    while (i < contents_.size())
+    // quote and escape sequences). Outside of literals and comments, only the characters that may start one,
+    // backslashes and the first character of the macro name are interesting, so everything in between is skipped in
+    // bulk.
+    while (true)
     {
-        char c = contents_[i];
+        cursor = find_any(cursor, end, '"', '\'', '/', '\\', macro_first);
+        if (cursor == end)
+        {
+            break;
+        }
+
+        char c = *cursor;
         if (c == '\\')
         {
-            if (in_macro && in_quote)
-            {
-                literal += c;
-                if (i + 1 >= contents_.size())
-                {
-                    throw std::runtime_error("Encountered backslash at end of file");
-                }
-                literal += contents_[i + 1];
-            }
             // Handle all backslashed escaped characters (note that this conveniently handles escaped backslashes)
-            i += 2;
+            cursor = skip_backslash(cursor, end);
             continue;
         }
 
         if (c == '"')
         {
-            in_quote = !in_quote;
-            ++i;
+            cursor = skip_string(cursor, end);
             continue;
         }
 
-        if (in_quote)
+        if (c == '\'')
         {
-            if (in_macro)
-            {
-                literal += c;
-            }
-            ++i;
+            cursor = skip_apostrophe(cursor, end);
+            continue;
+        }
+
+        if (c == '/')
+        {
+            const char* next = skip_comment(cursor, end);
+            cursor = next == cursor ? cursor + 1 : next;
+            continue;
+        }
+
+        // The macro name must start an identifier and match in its entirety
+        if ((cursor != begin && is_identifier(cursor[-1])) || static_cast<size_t>(end - cursor) < macro_size
+            || std::memcmp(cursor, macro_name_, macro_size) != 0)
+        {
+            ++cursor;
             continue;
         }
 
-        if (in_macro)
+        // The macro name followed by H is the hashed form of the macro
+        cursor += macro_size;
+        bool hashed = cursor < end && *cursor == 'H';
+        if (hashed)
         {
-            if (isspace(c))
+            ++cursor;
+        }
+
+        // Consume whitespace until we find a left parenthesis
+        while (cursor < end)
+        {
+            if (*cursor == '\\')
             {
-                ++i;
-                continue;
+                // Skip escaped characters
+                cursor = skip_backslash(cursor, end);
             }
-            else if (c == ')')
+            else if (is_space(*cursor))
             {
-                literals_.push_back(literal);
-                in_macro = false;
-                literal.clear();
+                ++cursor;
             }
             else
             {
-                throw std::runtime_error(std::string("Unsupported token ") + c + " found in spool macro");
+                break;
             }
         }
-        else
+
+        if (cursor < end && *cursor == '(')
+        {
+            // Macro name and leading parenthesis found, we're in a macro
+            cursor = parse_macro(cursor + 1, end, hashed ? hashed_literals_ : literals_);
+        }
+    }
+
+    // Literals of the hashed macro aren't counted by __COUNTER__, so they follow those of the counted macro
+    literals_.insert(literals_.end(), hashed_literals_.begin(), hashed_literals_.end());
+    hashed_literals_.clear();
+}
+
+const char* Parser::skip_quote(const char* cursor, const char* end)
+{
+    while (true)
+    {
+        cursor = find_any(cursor, end, '"', '\\');
+        if (cursor >= end)
+        {
+            return end;
+        }
+
+        if (*cursor == '"')
+        {
+            return cursor + 1;
+        }
+
+        cursor = skip_backslash(cursor, end);
+    }
+}
+
+const char* Parser::skip_string(const char* quote, const char* end)
+{
+    // Only raw strings are preceded by an R, and their prefix must be checked since any identifier may end in one
+    if (quote != contents_.data() && quote[-1] == 'R')
+    {
+        const char* start = token_start(contents_.data(), quote);
+        std::string_view body;
+        const char* next;
+        if (is_raw_prefix({start, static_cast<size_t>(quote - start)}) && scan_raw_string(quote, end, body, next))
         {
-            char last = contents_[i - 1];
-            if (isalnum(last))
+            return next;
+        }
+    }
+    return skip_quote(quote + 1, end);
+}
+
+const char* Parser::skip_apostrophe(const char* cursor, const char* end)
+{
+    // Digit separators only occur within numbers (1'000'000 or 0xff'ff), while character literals start a token or
+    // follow an encoding prefix
+    const char* start = cursor;
+    while (start != contents_.data() && (is_identifier(start[-1]) || start[-1] == '\'' || start[-1] == '.'))
+    {
+        --start;
+    }
+    if (start != cursor && (isdigit(static_cast<unsigned char>(*start)) || *start == '.'))
+    {
+        return cursor + 1;
+    }
+
+    ++cursor;
+    while (true)
+    {
+        cursor = find_any(cursor, end, '\'', '\\', '\n');
+        if (cursor >= end)
+        {
+            return end;
+        }
+
+        if (*cursor == '\\')
+        {
+            cursor = skip_backslash(cursor, end);
+            continue;
+        }
+
+        // A stray apostrophe, as in text skipped by the preprocessor (#if 0 ... don't ... #endif), ends with its line
+        return cursor + 1;
+    }
+}
+
+const char* Parser::skip_comment(const char* cursor, const char* end)
+{
+    if (end - cursor < 2)
+    {
+        return cursor;
+    }
+
+    if (cursor[1] == '/')
+    {
+        // Line comments continue onto the next line after a line splice
+        cursor += 2;
+        while (true)
+        {
+            cursor = find_any(cursor, end, '\n', '\\');
+            if (cursor >= end)
+            {
+                return end;
+            }
+            if (*cursor == '\n')
+            {
+                return cursor + 1;
+            }
+            cursor = skip_backslash(cursor, end);
+        }
+    }
+
+    if (cursor[1] == '*')
+    {
+        for (cursor += 2;; ++cursor)
+        {
+            cursor = find_any(cursor, end, '*');
+            if (end - cursor < 2)
             {
-                ++i;
-                continue;
+                return end;
             }
+            if (cursor[1] == '/')
+            {
+                return cursor + 2;
+            }
+        }
+    }
+
+    return cursor;
+}
+
+// Returns the opening quote of the string literal whose encoding prefix starts at cursor, and whether it is raw. Only
+// literals of narrow characters can be pooled.
+static const char* skip_prefix(const char* cursor, const char* end, bool& raw)
+{
+    const char* quote = cursor;
+    while (quote < end && is_identifier(*quote))
+    {
+        ++quote;
+    }
+
+    std::string_view prefix{cursor, static_cast<size_t>(quote - cursor)};
+    if (quote == end || *quote != '"')
+    {
+        throw std::runtime_error(std::string("Unsupported token ") + *cursor + " found in spool macro");
+    }
+    if (prefix == "L" || prefix == "u" || prefix == "U" || prefix == "LR" || prefix == "uR" || prefix == "UR")
+    {
+        throw std::runtime_error("Wide string literal " + std::string{prefix} + "\"...\" found in spool macro");
+    }
+    if (prefix != "u8" && !is_raw_prefix(prefix))
+    {
+        throw std::runtime_error(std::string("Unsupported token ") + *cursor + " found in spool macro");
+    }
+
+    raw = prefix.back() == 'R';
+    return quote;
+}
+
+// Bytes of a raw string body, with CRLF line endings read as LF like the compiler does
+static std::string raw_bytes(std::string_view body)
+{
+    std::string out;
+    for (size_t i = 0; i != body.size(); ++i)
+    {
+        if (body[i] != '\r' || i + 1 == body.size() || body[i + 1] != '\n')
+        {
+            out += body[i];
+        }
+    }
+    return out;
+}
 
-            const char* macro_cursor = macro_name_;
-            bool macro_found = false;
+const char* Parser::parse_macro(const char* cursor, const char* end, std::vector<std::string_view>& literals)
+{
+    // A literal made of a single ordinary quoted segment is a view of the contents, escapes and all. Anything else is
+    // built from the bytes of its segments, and stored in their escaped spelling in storage owned by the parser.
+    std::string_view literal;
+    std::string bytes;
+    bool built = false;
+    bool quoted = false;
 
-            // We're scanning ahead for the occurence of the macro string
-            for (; i < contents_.size(); ++i, ++macro_cursor)
+    while (cursor < end)
+    {
+        char c = *cursor;
+        if (c == '"' || is_identifier(c))
+        {
+            const char* quote = cursor;
+            bool raw = false;
+            if (c != '"')
             {
-                if (*macro_cursor == '\0')
-                {
-                    macro_found = true;
-                    break;
-                }
+                quote = skip_prefix(cursor, end, raw);
+            }
 
-                if (*macro_cursor != contents_[i])
+            std::string_view segment;
+            if (raw)
+            {
+                if (!scan_raw_string(quote, end, segment, cursor))
                 {
-                    break;
+                    throw std::runtime_error("Malformed raw string literal found in spool macro");
                 }
             }
-
-            if (macro_found)
+            else
             {
-                // Consume whitespace until we find a left parenthesis
-                for (; i < contents_.size(); ++i)
+                // Find the closing quote, stopping only at escapes
+                const char* first = quote + 1;
+                const char* stop = first;
+                while (true)
                 {
-                    char c = contents_[i];
-                    if (c == '\\')
+                    stop = find_any(stop, end, '"', '\\');
+                    if (stop == end)
                     {
-                        // Skip escaped characters
-                        ++i;
-                        continue;
+                        return end;
                     }
 
-                    if (!isspace(c))
+                    if (*stop == '"')
                     {
-                        if (c == '(')
-                        {
-                            // Macro name and leading parenthesis found, we're in a macro
-                            in_macro = true;
-                        }
                         break;
                     }
+
+                    if (stop + 1 >= end)
+                    {
+                        throw std::runtime_error("Encountered backslash at end of file");
+                    }
+                    stop = skip_backslash(stop, end);
+                }
+                segment = {first, static_cast<size_t>(stop - first)};
+                cursor = stop + 1;
+            }
+
+            if (!quoted && !raw)
+            {
+                literal = segment;
+                quoted = true;
+            }
+            else
+            {
+                // Adjacent literals are joined by their bytes rather than their spellings, so that an escape ending one
+                // segment (such as \x4 or \1) can't absorb the characters starting the next
+                if (!built)
+                {
+                    bytes = quoted ? unescape(literal) : std::string{};
+                    built = true;
                 }
+                bytes += raw ? raw_bytes(segment) : unescape(segment);
+                quoted = true;
+            }
+        }
+        else if (c == ')')
+        {
+            if (built)
+            {
+                std::string& joined = joined_.emplace_back();
+                escape(bytes, joined);
+                literal = joined;
             }
+            literals.push_back(literal);
+            return cursor + 1;
+        }
+        else if (c == '\\')
+        {
+            cursor = skip_backslash(cursor, end);
+        }
+        else if (is_space(c))
+        {
+            ++cursor;
+        }
+        else if (c == '/' && skip_comment(cursor, end) != cursor)
+        {
+            cursor = skip_comment(cursor, end);
+        }
+        else
+        {
+            throw std::runtime_error(std::string("Unsupported token ") + c + " found in spool macro");
         }
-        ++i;
     }
+
+    return end;
 }
 
 void Parser::print()
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <deque>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -7,9 +8,10 @@
 class Parser
 {
 public:
+    // The contents need not be null-terminated and must outlive the parser and the literals it produces
     Parser(const char* contents, size_t size, const char* macro_name);
 
-    // Scan the contents looking for occurrences of [MACRO_NAME]("literal")
+    // Scan the contents looking for occurrences of [MACRO_NAME]("literal") and of the hashed [MACRO_NAME]H("literal")
     // Handles the following edge cases:
     // - Escaped characters
     // - Occurrences of the macro in quoted text
@@ -17,9 +19,16 @@ public:
     // - Whitespace between macro arguments and trailing paren
     // - Coalescing of adjacent C string literals
     // - Escaping within C string literals
+    // - Raw string literals (R"delim(...)delim"), which are stored in the escaped spelling of their bytes
+    // - u8 prefixes (wide literals can't be pooled and are rejected within the macro)
+    // - Quotes and the macro name within character literals and comments
+    // - Line splices
     void parse();
 
-    [[nodiscard]] const std::vector<std::string>& literals() const noexcept
+    // Literals view directly into the parsed contents, except for coalesced and raw literals, which are owned by the
+    // parser and spelled by escaping their bytes.
+    // Those of the hashed macro follow all those of the counted macro, which keep their __COUNTER__ order.
+    [[nodiscard]] const std::vector<std::string_view>& literals() const noexcept
     {
         return literals_;
     }
@@ -28,7 +37,22 @@ public:
     void print();
 
 private:
+    // Returns the position just past the closing quote of the quoted text starting at cursor
+    const char* skip_quote(const char* cursor, const char* end);
+    // Returns the position just past the string literal, raw or not, whose opening quote is at quote
+    const char* skip_string(const char* quote, const char* end);
+    // Returns the position just past the character literal or digit separator at cursor
+    const char* skip_apostrophe(const char* cursor, const char* end);
+    // Returns the position just past the comment starting at cursor, or cursor if there is none
+    const char* skip_comment(const char* cursor, const char* end);
+
+    // Records the literal of the macro whose arguments start at cursor and returns the position past its parenthesis
+    const char* parse_macro(const char* cursor, const char* end, std::vector<std::string_view>& literals);
+
     std::string_view contents_;
-    std::vector<std::string> literals_;
+    std::vector<std::string_view> literals_;
+    std::vector<std::string_view> hashed_literals_;
+    // Storage for literals coalesced from several adjacent C string literals (a deque keeps references stable)
+    std::deque<std::string> joined_;
     const char* macro_name_;
 };
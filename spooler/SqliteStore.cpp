@@ -0,0 +1,381 @@
+#include "SqliteStore.hpp"
+#include "Schema.hpp"
+#include "Stats.hpp"
+
+#include <initializer_list>
+
+// Literals may hold arbitrary bytes, so they are staged in a temporary table. New strings receive ROWIDs in order of
+// first use, as if they had been inserted one at a time.
+static const char* create_new_strings =
+    "CREATE TEMP TABLE IF NOT EXISTS new_strings (local INTEGER PRIMARY KEY, string TEXT NOT NULL);"
+    "DELETE FROM temp.new_strings;";
+static const char* insert_strings =
+    "INSERT OR IGNORE INTO strings (string) SELECT string FROM temp.new_strings ORDER BY local;";
+static const char* select_ids = "SELECT n.local, s.ROWID FROM temp.new_strings n JOIN strings s ON s.string = n.string;";
+
+// Everything else is numeric and bound as a single JSON array per statement, so each statement below runs once per
+// commit rather than once per row
+static const char* select_origins =
+    "SELECT path_id, id, ref_count FROM origins WHERE path_id IN (SELECT value FROM json_each(?));";
+
+// [[id, delta], ...]
+static const char* update_strings = "UPDATE strings SET ref_count = ref_count + (d.value ->> 1) FROM json_each(?) d "
+                                    "WHERE strings.ROWID = d.value ->> 0;";
+static const char* remove_strings =
+    "DELETE FROM strings WHERE ref_count <= 0 AND ROWID IN (SELECT value ->> 0 FROM json_each(?));";
+
+// [[path_id, id, ref_count], ...] where a ref count of zero means the source no longer uses the string
+static const char* remove_origins = "DELETE FROM origins WHERE (path_id, id) IN "
+                                    "(SELECT value ->> 0, value ->> 1 FROM json_each(?) WHERE value ->> 2 = 0);";
+static const char* upsert_origins = "INSERT OR REPLACE INTO origins (path_id, id, ref_count) "
+                                    "SELECT value ->> 0, value ->> 1, value ->> 2 FROM json_each(?) WHERE value ->> 2 > 0;";
+
+// [path_id, ...]
+static const char* remove_uses = "DELETE FROM flat_offsets WHERE path_id IN (SELECT value FROM json_each(?));";
+// [id, ...] of a single source, in order of use
+static const char* insert_uses =
+    "INSERT INTO flat_offsets (path_id, id) SELECT ?, value FROM json_each(?) ORDER BY key;";
+
+// [path_id, ...]
+static const char* select_hashes =
+    "SELECT path_id, hash FROM source_hashes WHERE path_id IN (SELECT value FROM json_each(?));";
+// [[path_id, hash], ...]
+static const char* upsert_hashes =
+    "INSERT OR REPLACE INTO source_hashes (path_id, hash) SELECT value ->> 0, value ->> 1 FROM json_each(?);";
+
+// [[hash, count], ...]
+static const char* insert_profile =
+    "INSERT OR REPLACE INTO profile (hash, count) SELECT value ->> 0, value ->> 1 FROM json_each(?);";
+
+// Renumbers the strings densely in ROWID order. The rows are copied out and back rather than updated in place, which
+// could collide with the ids of rows not yet renumbered.
+static const char* compact_ids =
+    "DELETE FROM strings WHERE ref_count <= 0;"
+    "DROP TABLE IF EXISTS temp.renumbered;"
+    "CREATE TEMP TABLE renumbered (old INTEGER PRIMARY KEY, new INTEGER NOT NULL);"
+    "INSERT INTO temp.renumbered (old, new) SELECT ROWID, ROW_NUMBER() OVER (ORDER BY ROWID) FROM strings;"
+    "CREATE TEMP TABLE old_strings AS SELECT r.new AS id, s.string, s.ref_count "
+    "    FROM strings s JOIN temp.renumbered r ON r.old = s.ROWID;"
+    "DELETE FROM strings;"
+    "INSERT INTO strings (ROWID, string, ref_count) SELECT id, string, ref_count FROM temp.old_strings ORDER BY id;"
+    "CREATE TEMP TABLE old_origins AS SELECT o.path_id, r.new AS id, o.ref_count "
+    "    FROM origins o JOIN temp.renumbered r ON r.old = o.id;"
+    "DELETE FROM origins;"
+    "INSERT INTO origins (path_id, id, ref_count) SELECT path_id, id, ref_count FROM temp.old_origins;"
+    "UPDATE flat_offsets SET id = (SELECT new FROM temp.renumbered WHERE old = flat_offsets.id);"
+    "DROP TABLE temp.old_strings;"
+    "DROP TABLE temp.old_origins;"
+    "DROP TABLE temp.renumbered;";
+
+// Runs a statement with a JSON array as its only parameter, and returns the number of rows it changed
+static uint64_t execute_with(Database& db, const char* sql, const std::string& json)
+{
+    Statement statement = db.prepare(sql);
+    statement.bind(1, json);
+    statement.step();
+    return static_cast<uint64_t>(sqlite3_changes(db.handle()));
+}
+
+// Appends integers to a JSON array in progress, which finish_array closes
+static void append(std::string& json, int64_t value)
+{
+    json += json.empty() ? '[' : ',';
+    json += std::to_string(value);
+}
+
+static void append(std::string& json, std::initializer_list<int64_t> values)
+{
+    json += json.empty() ? '[' : ',';
+    char separator = '[';
+    for (auto value : values)
+    {
+        json += separator;
+        json += std::to_string(value);
+        separator = ',';
+    }
+    json += ']';
+}
+
+static void finish_array(std::string& json)
+{
+    json += json.empty() ? "[]" : "]";
+}
+
+SqliteStore::SqliteStore(const char* path)
+    : db_{path}
+{
+    // The schema only creates missing tables, so it is simply reapplied every time
+    db_.execute(spool_schema);
+}
+
+std::unordered_map<int, uint64_t> SqliteStore::source_hashes()
+{
+    StatsPhase phase{"query source_hashes"};
+    std::unordered_map<int, uint64_t> out;
+    Statement query = db_.prepare("SELECT path_id, hash FROM source_hashes;");
+    while (auto result = query.step<int, int64_t>())
+    {
+        auto&& [path_id, hash] = *result;
+        out[path_id] = static_cast<uint64_t>(hash);
+    }
+    stats_count("source_hashes rows read", out.size());
+    return out;
+}
+
+// Diffs the origins of the written sources in memory and applies the ref count changes with set-based statements
+size_t SqliteStore::write(const std::vector<std::string_view>& strings, std::vector<SourceLiterals> sources)
+{
+    db_.begin_write();
+
+    std::string source_ids;
+    for (auto& source : sources)
+    {
+        append(source_ids, source.id);
+    }
+    finish_array(source_ids);
+
+    // The hashes read before the transaction began may have been stale
+    std::unordered_map<int, uint64_t> stored;
+    {
+        StatsPhase phase{"query source_hashes"};
+        Statement query_hashes = db_.prepare(select_hashes);
+        query_hashes.bind(1, source_ids);
+        while (auto result = query_hashes.step<int, int64_t>())
+        {
+            auto&& [path_id, hash] = *result;
+            stored[path_id] = static_cast<uint64_t>(hash);
+        }
+        stats_count("source_hashes rows read", stored.size());
+    }
+    std::vector<bool> used = drop_unchanged(stored, strings.size(), sources);
+    if (sources.empty())
+    {
+        db_.commit();
+        return 0;
+    }
+
+    source_ids.clear();
+    std::string hashes;
+    for (auto& source : sources)
+    {
+        append(source_ids, source.id);
+        append(hashes, {source.id, static_cast<int64_t>(source.hash)});
+    }
+    finish_array(source_ids);
+    finish_array(hashes);
+
+    // Resolve the ids of all literals, inserting the strings seen for the first time
+    std::vector<int> ids(strings.size(), 0);
+    {
+        StatsPhase phase{"query strings"};
+        db_.execute(create_new_strings);
+        Statement insert_string = db_.prepare("INSERT INTO temp.new_strings (local, string) VALUES (?, ?);");
+        for (size_t i = 0; i != strings.size(); ++i)
+        {
+            if (!used[i])
+            {
+                continue;
+            }
+            insert_string.bind(1, static_cast<int>(i));
+            insert_string.bind(2, strings[i]);
+            insert_string.step();
+            insert_string.reset();
+        }
+        db_.execute(insert_strings);
+        stats_count("strings rows written", static_cast<uint64_t>(sqlite3_changes(db_.handle())));
+
+        Statement query_ids = db_.prepare(select_ids);
+        uint64_t rows = 0;
+        while (auto result = query_ids.step<int, int>())
+        {
+            auto&& [local, id] = *result;
+            ids[local] = id;
+            ++rows;
+        }
+        stats_count("strings rows read", rows);
+    }
+
+    // Old and new ref counts of each (source, string) pair of the changed sources
+    auto origin_key = [](int path_id, int id) {
+        return static_cast<uint64_t>(path_id) << 32 | static_cast<uint32_t>(id);
+    };
+    std::unordered_map<uint64_t, std::pair<int, int>> origins;
+
+    {
+        StatsPhase phase{"query origins"};
+        Statement query_origins = db_.prepare(select_origins);
+        query_origins.bind(1, source_ids);
+        while (auto result = query_origins.step<int, int, int>())
+        {
+            auto&& [path_id, id, ref_count] = *result;
+            origins[origin_key(path_id, id)].first = ref_count;
+        }
+        stats_count("origins rows read", origins.size());
+    }
+
+    for (auto& source : sources)
+    {
+        for (auto use : source.uses)
+        {
+            ++origins[origin_key(source.id, ids[use])].second;
+        }
+    }
+
+    // Diff the ref counts in memory so only the rows that change are written
+    std::unordered_map<int, int> deltas;
+    std::string origin_counts;
+    for (auto& [key, counts] : origins)
+    {
+        auto [old_count, new_count] = counts;
+        if (old_count == new_count)
+        {
+            continue;
+        }
+
+        int path_id = static_cast<int>(key >> 32);
+        int id = static_cast<int>(key & 0xffffffff);
+        deltas[id] += new_count - old_count;
+        append(origin_counts, {path_id, id, new_count});
+    }
+    finish_array(origin_counts);
+
+    std::string string_deltas;
+    for (auto [id, delta] : deltas)
+    {
+        if (delta != 0)
+        {
+            append(string_deltas, {id, delta});
+        }
+    }
+    finish_array(string_deltas);
+
+    StatsPhase phase{"update"};
+    stats_count("strings rows written", execute_with(db_, update_strings, string_deltas));
+    stats_count("strings rows written", execute_with(db_, remove_strings, string_deltas));
+    stats_count("origins rows written", execute_with(db_, remove_origins, origin_counts));
+    stats_count("origins rows written", execute_with(db_, upsert_origins, origin_counts));
+    stats_count("flat_offsets rows written", execute_with(db_, remove_uses, source_ids));
+    stats_count("source_hashes rows written", execute_with(db_, upsert_hashes, hashes));
+
+    Statement insert = db_.prepare(insert_uses);
+    std::string uses;
+    for (auto& source : sources)
+    {
+        uses.clear();
+        for (auto use : source.uses)
+        {
+            append(uses, ids[use]);
+        }
+        finish_array(uses);
+
+        insert.bind(1, source.id);
+        insert.bind(2, uses);
+        insert.step();
+        insert.reset();
+        stats_count("flat_offsets rows written", source.uses.size());
+    }
+
+    db_.commit();
+    return sources.size();
+}
+
+void SqliteStore::begin_read()
+{
+    db_.begin_read();
+}
+
+void SqliteStore::end_read()
+{
+    db_.commit();
+}
+
+void SqliteStore::for_each_string(const std::function<void(int, std::string_view)>& f)
+{
+    StatsPhase phase{"query strings"};
+    Statement query = db_.prepare(
+        "SELECT ROWID, string FROM strings WHERE ref_count > 0 ORDER BY ref_count DESC, ROWID ASC");
+    uint64_t rows = 0;
+    while (auto result = query.step<int, std::string>())
+    {
+        auto&& [id, str] = *result;
+        f(id, str);
+        ++rows;
+    }
+    stats_count("strings rows read", rows);
+}
+
+void SqliteStore::for_each_use(const std::function<void(int, int)>& f)
+{
+    StatsPhase phase{"query flat_offsets"};
+    Statement query = db_.prepare("SELECT path_id, id FROM flat_offsets ORDER BY path_id, ROWID ASC");
+    uint64_t rows = 0;
+    while (auto result = query.step<int, int>())
+    {
+        auto&& [path_id, id] = *result;
+        f(path_id, id);
+        ++rows;
+    }
+    stats_count("flat_offsets rows read", rows);
+}
+
+void SqliteStore::write_profile(const std::unordered_map<uint64_t, uint64_t>& counts)
+{
+    std::string json;
+    for (auto [hash, count] : counts)
+    {
+        append(json, {static_cast<int64_t>(hash), static_cast<int64_t>(count)});
+    }
+    finish_array(json);
+
+    db_.begin_write();
+    db_.execute("DELETE FROM profile;");
+    stats_count("profile rows written", execute_with(db_, insert_profile, json));
+    db_.commit();
+}
+
+std::unordered_map<uint64_t, uint64_t> SqliteStore::profile()
+{
+    StatsPhase phase{"query profile"};
+    std::unordered_map<uint64_t, uint64_t> out;
+    Statement query = db_.prepare("SELECT hash, count FROM profile;");
+    while (auto result = query.step<int64_t, int64_t>())
+    {
+        auto&& [hash, count] = *result;
+        out[static_cast<uint64_t>(hash)] = static_cast<uint64_t>(count);
+    }
+    stats_count("profile rows read", out.size());
+    return out;
+}
+
+StoreUsage SqliteStore::usage()
+{
+    StoreUsage usage;
+    Statement ids = db_.prepare("SELECT count(*), coalesce(max(ROWID), 0) FROM strings WHERE ref_count > 0;");
+    if (auto result = ids.step<int64_t, int64_t>())
+    {
+        auto&& [live, space] = *result;
+        usage.live_ids = static_cast<size_t>(live);
+        usage.id_space = static_cast<size_t>(space);
+    }
+    // Pages on the free list are reused by later writes, but only vacuuming returns them to the file system
+    Statement pages = db_.prepare(
+        "SELECT page_count, freelist_count, page_size FROM pragma_page_count(), pragma_freelist_count(), "
+        "pragma_page_size();");
+    if (auto result = pages.step<int64_t, int64_t, int64_t>())
+    {
+        auto&& [count, free, page_size] = *result;
+        usage.size = static_cast<size_t>(count * page_size);
+        usage.live_size = static_cast<size_t>((count - free) * page_size);
+    }
+    return usage;
+}
+
+void SqliteStore::compact()
+{
+    StatsPhase phase{"compact"};
+    db_.begin_write();
+    db_.execute(compact_ids);
+    db_.commit();
+    // Returns the pages freed by removed rows to the file system
+    db_.execute("VACUUM;");
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Database.hpp"
+#include "Store.hpp"
+
+// Store backed by the SQLite database described in sql/spool.sql
+class SqliteStore : public Store
+{
+public:
+    explicit SqliteStore(const char* path);
+
+    std::unordered_map<int, uint64_t> source_hashes() override;
+    size_t write(const std::vector<std::string_view>& strings, std::vector<SourceLiterals> sources) override;
+    void begin_read() override;
+    void end_read() override;
+    void for_each_string(const std::function<void(int, std::string_view)>& f) override;
+    void for_each_use(const std::function<void(int, int)>& f) override;
+    void write_profile(const std::unordered_map<uint64_t, uint64_t>& counts) override;
+    std::unordered_map<uint64_t, uint64_t> profile() override;
+    StoreUsage usage() override;
+    void compact() override;
+
+private:
+    Database db_;
+};
@@ -27,7 +27,7 @@ Statement::~Statement()
     sqlite3_finalize(stmt_);
 }
 
-void Statement::bind(int index, const std::string& text)
+void Statement::bind(int index, std::string_view text)
 {
     check(sqlite3_bind_text(stmt_, index, text.data(), text.size(), SQLITE_STATIC));
 }
@@ -36,6 +36,12 @@ void Statement::bind(int index, int value)
 {
     check(sqlite3_bind_int(stmt_, index, value));
 }
+
+void Statement::bind(int index, int64_t value)
+{
+    check(sqlite3_bind_int64(stmt_, index, value));
+}
+
 void Statement::reset()
 {
     sqlite3_reset(stmt_);
@@ -59,6 +65,11 @@ template <> int Statement::extract<int>(size_t index)
     return sqlite3_column_int(stmt_, index);
 }
 
+template <> int64_t Statement::extract<int64_t>(size_t index)
+{
+    return sqlite3_column_int64(stmt_, index);
+}
+
 template <> std::string Statement::extract<std::string>(size_t index)
 {
     const void* ptr = sqlite3_column_text(stmt_, index);
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <sqlite3.h>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 
@@ -18,8 +20,9 @@ public:
     // Rearm the statement to be bound and executed again
     void reset();
 
-    void bind(int index, const std::string& text);
+    void bind(int index, std::string_view text);
     void bind(int index, int value);
+    void bind(int index, int64_t value);
 
     // Use this overload if no contents are desired and you wish to simply execute the statement
     bool step();
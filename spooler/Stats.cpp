@@ -0,0 +1,234 @@
+#include "Stats.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+static Stats* current_stats = nullptr;
+
+static double microseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+static int process_id()
+{
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+// Appends `str` as a JSON string
+static void append_json_string(std::string& out, const std::string& str)
+{
+    out += '"';
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// Appends a complete ("X") event of the Chrome trace event format
+static void append_event(std::string& out, const char* name, double start, double duration, int pid)
+{
+    char event[128];
+    out += "{\"name\":";
+    append_json_string(out, name);
+    snprintf(event, sizeof(event), ",\"cat\":\"spooler\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":0",
+             start, duration, pid);
+    out += event;
+}
+
+Stats::Stats(int argc, char** argv)
+    : name_{argc > 1 ? argv[1] : "spooler"}
+    , start_{std::chrono::steady_clock::now()}
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        command_ += i == 1 ? "" : " ";
+        command_ += argv[i];
+    }
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    epoch_start_ = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count();
+    current_stats = this;
+}
+
+Stats::~Stats()
+{
+    current_stats = nullptr;
+}
+
+Stats* Stats::current() noexcept
+{
+    return current_stats;
+}
+
+void Stats::add_phase(const char* name, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end)
+{
+    phases_.push_back({name, start, end});
+}
+
+void Stats::add_count(const char* name, uint64_t value)
+{
+    // Counters are mostly added to from the same place, so the literal usually has the same address
+    for (auto& [counter, count] : counts_)
+    {
+        if (counter == name || std::strcmp(counter, name) == 0)
+        {
+            count += value;
+            return;
+        }
+    }
+    counts_.emplace_back(name, value);
+}
+
+bool Stats::report(const std::string& output)
+{
+    end_ = std::chrono::steady_clock::now();
+    if (output == "-")
+    {
+        print();
+        return true;
+    }
+    return append_trace(output.c_str());
+}
+
+// Phases that ran more than once, such as the reading and parsing of each file of a batch, are summed up. Phases may
+// nest (writing includes waiting for the lock), so their times don't add up to the total.
+void Stats::print() const
+{
+    struct Total
+    {
+        const char* name;
+        std::chrono::steady_clock::duration time;
+        size_t count;
+    };
+    std::vector<Total> totals;
+    for (auto& phase : phases_)
+    {
+        auto total = totals.begin();
+        while (total != totals.end() && std::strcmp(total->name, phase.name) != 0)
+        {
+            ++total;
+        }
+        if (total == totals.end())
+        {
+            total = totals.insert(total, {phase.name, {}, 0});
+        }
+        total->time += phase.end - phase.start;
+        ++total->count;
+    }
+
+    printf("Stats of spooler %s: %.3f ms\n", command_.c_str(), microseconds(end_ - start_) / 1000);
+    for (auto& total : totals)
+    {
+        printf("  %-28s %12.3f ms", total.name, microseconds(total.time) / 1000);
+        if (total.count > 1)
+        {
+            printf(" (%zu times)", total.count);
+        }
+        printf("\n");
+    }
+    for (auto& [name, count] : counts_)
+    {
+        printf("  %-28s %12" PRIu64 "\n", name, count);
+    }
+}
+
+// Creates the trace file at path with its opening bracket unless it exists. The file appears with the bracket already in
+// it, so commands running in parallel never append events ahead of it.
+static bool create_trace(const char* path, int pid)
+{
+    std::error_code error;
+    if (std::filesystem::exists(path, error))
+    {
+        return true;
+    }
+
+    std::string tmp_path = std::string{path} + "." + std::to_string(pid) + ".tmp";
+    std::FILE* fp = std::fopen(tmp_path.c_str(), "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    bool ok = std::fputs("[\n", fp) >= 0;
+    ok = std::fclose(fp) == 0 && ok;
+
+    // Linking fails if another command created the file first, which is just as good
+    if (ok)
+    {
+        std::filesystem::create_hard_link(tmp_path, path, error);
+    }
+    std::filesystem::remove(tmp_path, error);
+    return ok && std::filesystem::exists(path, error);
+}
+
+// The events are written in the JSON array format, whose closing bracket is optional. Each command appends its events
+// with a single write, so commands running in parallel don't interleave them.
+bool Stats::append_trace(const char* path) const
+{
+    int pid = process_id();
+    if (!create_trace(path, pid))
+    {
+        return false;
+    }
+
+    auto timestamp = [&](std::chrono::steady_clock::time_point time) {
+        return static_cast<double>(epoch_start_) + microseconds(time - start_);
+    };
+
+    // The event of the whole command carries its arguments and counters
+    std::string events;
+    append_event(events, name_.c_str(), timestamp(start_), microseconds(end_ - start_), pid);
+    events += ",\"args\":{\"command\":";
+    append_json_string(events, command_);
+    for (size_t i = 0; i != counts_.size(); ++i)
+    {
+        events += ',';
+        append_json_string(events, counts_[i].first);
+        events += ':';
+        events += std::to_string(counts_[i].second);
+    }
+    events += "}},\n";
+
+    for (auto& phase : phases_)
+    {
+        append_event(events, phase.name, timestamp(phase.start), microseconds(phase.end - phase.start), pid);
+        events += "},\n";
+    }
+
+    std::FILE* fp = std::fopen(path, "ab");
+    if (!fp)
+    {
+        return false;
+    }
+    std::setvbuf(fp, nullptr, _IOFBF, events.size());
+    std::fwrite(events.data(), 1, events.size(), fp);
+    bool ok = std::ferror(fp) == 0;
+    return std::fclose(fp) == 0 && ok;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Wall time of the phases of a spooler command and counts of the work it did, collected when the command is run with
+// --stats (or SPOOLER_STATS is set). Instrumented code records into the collector of the running command, and does
+// nothing beyond a null check when there is none.
+class Stats
+{
+public:
+    // Collects the stats of the command in argv until destroyed. Commands run one at a time, so there is at most one
+    // collector.
+    Stats(int argc, char** argv);
+    Stats(const Stats&) = delete;
+    Stats(Stats&&) = delete;
+    Stats& operator=(const Stats&) = delete;
+    Stats& operator=(Stats&&) = delete;
+    ~Stats();
+
+    // The collector of the running command, or nullptr if stats are off
+    static Stats* current() noexcept;
+
+    // Phase names and counter names must be string literals
+    void add_phase(const char* name, std::chrono::steady_clock::time_point start,
+                   std::chrono::steady_clock::time_point end);
+    void add_count(const char* name, uint64_t value);
+
+    // Prints the command's stats to stdout if output is "-", and otherwise appends them as Chrome trace events to the
+    // file at output, so the traces of many commands accumulate in one file. Returns false if the file couldn't be
+    // written.
+    bool report(const std::string& output);
+
+private:
+    struct Phase
+    {
+        const char* name;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+
+    void print() const;
+    bool append_trace(const char* path) const;
+
+    // The command, such as merge, and the whole command line
+    std::string name_;
+    std::string command_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point end_;
+    // Microseconds since the epoch at start_, so the traces of different processes line up
+    int64_t epoch_start_;
+    std::vector<Phase> phases_;
+    // In order of first use
+    std::vector<std::pair<const char*, uint64_t>> counts_;
+};
+
+// Records the time from construction to destruction as a phase of the running command
+class StatsPhase
+{
+public:
+    explicit StatsPhase(const char* name)
+        : name_{name}
+        , stats_{Stats::current()}
+    {
+        if (stats_)
+        {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    StatsPhase(const StatsPhase&) = delete;
+    StatsPhase& operator=(const StatsPhase&) = delete;
+
+    ~StatsPhase()
+    {
+        if (stats_)
+        {
+            stats_->add_phase(name_, start_, std::chrono::steady_clock::now());
+        }
+    }
+
+private:
+    const char* name_;
+    Stats* stats_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Adds to a counter of the running command
+inline void stats_count(const char* name, uint64_t value)
+{
+    if (Stats* stats = Stats::current())
+    {
+        stats->add_count(name, value);
+    }
+}
@@ -0,0 +1,37 @@
+#include "Store.hpp"
+#include "BinaryStore.hpp"
+#include "SqliteStore.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+std::vector<bool> drop_unchanged(const std::unordered_map<int, uint64_t>& stored, size_t string_count,
+                                 std::vector<SourceLiterals>& sources)
+{
+    sources.erase(std::remove_if(sources.begin(), sources.end(),
+                                 [&](const SourceLiterals& source) {
+                                     auto hash = stored.find(source.id);
+                                     return hash != stored.end() && hash->second == source.hash;
+                                 }),
+                  sources.end());
+
+    std::vector<bool> used(string_count, false);
+    for (auto& source : sources)
+    {
+        for (auto use : source.uses)
+        {
+            used[use] = true;
+        }
+    }
+    return used;
+}
+
+std::unique_ptr<Store> open_store(const char* path)
+{
+    std::string_view view{path};
+    if (view.size() >= 3 && view.substr(view.size() - 3) == ".db")
+    {
+        return std::make_unique<SqliteStore>(path);
+    }
+    return std::make_unique<BinaryStore>(path);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Literals of a source to be stored, as indices into a list of distinct strings
+struct SourceLiterals
+{
+    int id;
+    // Hash of the ordered literals, used to skip sources that didn't change
+    uint64_t hash;
+    std::vector<uint32_t> uses;
+};
+
+// What compacting the store would reclaim. Ids of removed strings are never reused, and removed strings and superseded
+// literals may keep taking up space, so both grow until the store is compacted.
+struct StoreUsage
+{
+    // Number of strings in use and the size of the id space they are numbered in
+    size_t live_ids = 0;
+    size_t id_space = 0;
+    // Bytes the store takes up, and about how many it would take up once compacted
+    size_t size = 0;
+    size_t live_size = 0;
+};
+
+// Persistent state of a spool: the pooled strings and the ordered literals of every source. String ids are stable
+// until the store is compacted.
+class Store
+{
+public:
+    virtual ~Store() = default;
+
+    // Hash of the literals last written for each source
+    virtual std::unordered_map<int, uint64_t> source_hashes() = 0;
+
+    // Replaces the literals of each of the given sources at once. Strings are stored in their escaped spelling. Sources
+    // whose stored hash already matches are left out. Other spoolers may write the store concurrently, so this is
+    // checked again within the write. Returns the number of sources written.
+    virtual size_t write(const std::vector<std::string_view>& strings, std::vector<SourceLiterals> sources) = 0;
+
+    // Reads between these calls see a single snapshot of the store
+    virtual void begin_read() = 0;
+    virtual void end_read() = 0;
+
+    // Invokes f(id, string) for every string in use, most referenced first (and by id among equals)
+    virtual void for_each_string(const std::function<void(int, std::string_view)>& f) = 0;
+
+    // Invokes f(source id, string id) for every literal, ordered by source and by position within the source
+    virtual void for_each_use(const std::function<void(int, int)>& f) = 0;
+
+    // Replaces the runtime access profile: how often the string with each 64-bit FNV-1a hash (of its unescaped bytes)
+    // was used by a profiled run
+    virtual void write_profile(const std::unordered_map<uint64_t, uint64_t>& counts) = 0;
+
+    // The last profile written, empty if there is none
+    virtual std::unordered_map<uint64_t, uint64_t> profile() = 0;
+
+    virtual StoreUsage usage() = 0;
+
+    // Renumbers the strings in use densely, keeping their order, and reclaims the space of everything removed
+    virtual void compact() = 0;
+};
+
+// Removes the sources whose hash in `stored` matches theirs, and returns which strings the remaining sources use
+std::vector<bool> drop_unchanged(const std::unordered_map<int, uint64_t>& stored, size_t string_count,
+                                 std::vector<SourceLiterals>& sources);
+
+// Opens the store at path, creating it if needed. Paths ending in .db are SQLite databases, anything else uses the
+// native binary format.
+std::unique_ptr<Store> open_store(const char* path);
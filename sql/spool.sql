@@ -19,3 +19,15 @@ CREATE TABLE IF NOT EXISTS flat_offsets (
 );
 
 CREATE INDEX IF NOT EXISTS path_id_index ON flat_offsets (path_id);
+
+-- Hash of the ordered literals last seen in each source, used to skip sources whose literals are unchanged
+CREATE TABLE IF NOT EXISTS source_hashes (
+    path_id INT PRIMARY KEY,
+    hash INT NOT NULL
+);
+
+-- Runtime access count of each string by the hash of its contents, written by `spooler profile`
+CREATE TABLE IF NOT EXISTS profile (
+    hash INT PRIMARY KEY,
+    count INT NOT NULL
+);
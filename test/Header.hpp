@@ -0,0 +1,9 @@
+#pragma once
+
+#include <spool.h>
+
+// Headers can't use SP, whose uses are numbered per source, but can use SPH
+inline const char* header_greeting()
+{
+    return SPH("greetings from a header");
+}
@@ -1,29 +1,34 @@
 #include <spool.h>
+#include <spool_intern.h>
+#include <spool_map.h>
+#include <spool_profile.h>
 
+#include "Header.hpp"
 #include "Test.hpp"
+#include <atomic>
 #include <cstdio>
-
-static size_t test_count = 0;
-static size_t test_passes = 0;
-
-void test(bool condition, const char* cond_str, const char* file, int line)
-{
-    ++test_count;
-    if (condition)
-    {
-        ++test_passes;
-    }
-    else
-    {
-        printf("[%s:%d] Test failed: %s\n", file, line, cond_str);
-    }
-}
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 extern const char* tu1_foo;
 extern const char* tu1_bar;
 extern const char* tu1_zoo;
 extern const char* lib1_x;
 extern const char* lib2_x;
+extern const char* tu1_escaped;
+extern const char* tu2_raw;
+extern const char* tu2_raw_delimited;
+extern const char* tu2_u8;
+extern const char* tu2_joined;
+extern const char* tu2_spliced;
+extern const char* tu2_hex_joined;
+extern const char* tu2_octal_joined;
+extern const char* tu2_hex_raw_joined;
+extern const char* tu1_hashed;
+extern const char* tu1_header_greeting;
 
 int main(int argc, char** argv)
 {
@@ -40,5 +45,141 @@ int main(int argc, char** argv)
     TEST(lib1_x == SP("x"));
     TEST(lib1_x == lib2_x);
 
-    printf("%d out of %d tests passed.\n", test_passes, test_count);
+    // Differently escaped spellings of the same bytes are pooled together
+    const char* escaped = SP("AB\11C");
+    TEST(escaped == tu1_escaped);
+    TEST(strcmp(escaped, "AB\tC") == 0);
+    TEST(strcmp(foo, "super") == 0);
+
+    // Raw, prefixed, commented and spliced literals pool with their plain spellings
+    TEST(strcmp(tu2_raw, "C:\\path \"quoted\"") == 0);
+    TEST(strcmp(tu2_raw_delimited, "a)\"b") == 0);
+    TEST(tu2_u8 == foo);
+    TEST(tu2_joined == foo);
+    TEST(tu2_spliced == zoo);
+
+    // Adjacent segments are joined by their bytes, not by pasting their spellings together ("\x41" or "\12")
+    TEST(spool_len(tu2_hex_joined) == 2 && memcmp(tu2_hex_joined, "\x04" "1", 3) == 0);
+    TEST(spool_len(tu2_octal_joined) == 2 && memcmp(tu2_octal_joined, "\x01" "2", 3) == 0);
+    TEST(tu2_hex_raw_joined == tu2_hex_joined);
+    TEST(spool::id{tu2_hex_joined} == spool::id{SP("\0041")});
+    TEST(spool::id{tu2_hex_joined} != spool::id{SP("A")});
+    TEST(spool::id{tu2_octal_joined} == spool::id{SP("\0012")});
+    TEST(spool::id{tu2_octal_joined} != spool::id{SP("\n")});
+    TEST(spool_hash(tu2_hex_joined) == spool_hash_bytes("\x04" "1", 2));
+
+    // The hashed macro pools by contents, in sources and in the inline functions of headers alike
+    TEST(tu1_hashed == foo);
+    TEST(SPH("duper") == zoo);
+    TEST(header_greeting() == tu1_header_greeting);
+    TEST(header_greeting() == spool_find("greetings from a header", 23));
+    TEST(spool_len(header_greeting()) == 23);
+
+    TEST(spool_len(foo) == 5);
+    TEST(spool_len(escaped) == 4);
+    TEST(spool_hash(foo) == spool_hash(tu1_foo));
+    TEST(spool_hash(foo) != spool_hash(zoo));
+    // FNV-1a of "x"
+    TEST(spool_hash(lib1_x) == 0xaf63f54c86021707ull);
+
+    spool::id foo_id{foo};
+    TEST(foo_id == spool::id{tu1_foo});
+    TEST(foo_id != spool::id{zoo});
+    TEST(foo_id.c_str() == foo);
+    TEST(foo_id.size() == 5);
+    TEST(foo_id.hash() == spool_hash(foo));
+
+    spool::dense_map<int> counts;
+    ++counts[foo_id];
+    ++counts[spool::id{bar}];
+    ++counts[spool::id{zoo}];
+    TEST(counts.size() == 2);
+    TEST(*counts.find(foo_id) == 2);
+    TEST(counts.erase(foo_id));
+    TEST(!counts.contains(foo_id));
+    TEST(*counts.find(spool::id{zoo}) == 1);
+
+    spool::flat_set seen;
+    TEST(seen.insert(foo_id));
+    TEST(!seen.insert(spool::id{tu1_bar}));
+    TEST(seen.contains(foo_id));
+    TEST(!seen.contains(spool::id{lib1_x}));
+    TEST(seen.size() == 1);
+
+    // Runtime strings resolve to the pooled pointer when the contents are pooled
+    std::string built = std::string{"sup"} + "er";
+    TEST(spool_find(built.data(), built.size()) == foo);
+    TEST(spool_find("supe", 4) == nullptr);
+    TEST(spool_find("", 0) == nullptr);
+
+    // Every pooled string has its own slot in the perfect hash
+    bool all_found = true;
+    for (uint32_t i = 0; i != spool::id::count(); ++i)
+    {
+        spool::id id = spool::id::from_index(i);
+        all_found = all_found && spool_find(id.c_str(), id.size()) == id.c_str();
+    }
+    TEST(all_found);
+    TEST(spool_intern(built) == foo);
+    TEST(spool_intern("AB\tC") == escaped);
+
+    const char* dynamic = spool_intern(built + "!");
+    TEST(strcmp(dynamic, "super!") == 0);
+    TEST(spool_intern("super!") == dynamic);
+    TEST(spool_intern("super?") != dynamic);
+
+    // Concurrent interning of overlapping strings agrees on a single pointer per string
+    constexpr int thread_count = 8;
+    constexpr int string_count = 20000;
+    std::vector<std::vector<const char*>> results(thread_count);
+    std::vector<std::thread> threads;
+    for (int t = 0; t != thread_count; ++t)
+    {
+        threads.emplace_back([t, &results] {
+            results[t].resize(string_count);
+            for (int i = 0; i != string_count; ++i)
+            {
+                int n = (i * 7 + t * 13) % string_count;
+                results[t][n] = spool_intern("runtime_" + std::to_string(n));
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    bool agree = true;
+    for (int n = 0; n != string_count; ++n)
+    {
+        for (int t = 1; t != thread_count; ++t)
+        {
+            agree = agree && results[t][n] == results[0][n];
+        }
+        agree = agree && results[0][n] == spool_intern("runtime_" + std::to_string(n));
+    }
+    TEST(agree);
+
+    // TU1 is compiled with SPOOL_PROFILE, so its static initializers counted their uses
+    TEST(spool::profile_count(foo) == 2);
+    TEST(spool::profile_count(zoo) == 1);
+    TEST(spool::profile_count(lib1_x) == 0);
+    TEST(spool::profile_hit(lib1_x) == lib1_x);
+    TEST(spool::profile_count(lib1_x) == 1);
+
+    std::string profile_path = std::string{argv[0]} + ".profile";
+    TEST(spool::write_profile(profile_path.c_str()));
+    std::ifstream profile{profile_path};
+    std::string line;
+    int profiled = 0;
+    bool found_x = false;
+    while (std::getline(profile, line))
+    {
+        ++profiled;
+        found_x = found_x || line == "af63f54c86021707 1";
+    }
+    TEST(profiled == 4);
+    TEST(found_x);
+
+    return test_report();
 }
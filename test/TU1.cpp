@@ -3,3 +3,9 @@
 const char* tu1_foo = SP("super");
 const char* tu1_bar = SP("super");
 const char* tu1_zoo = SP("duper");
+const char* tu1_escaped = SP("A\x42\tC");
+
+#include "Header.hpp"
+
+const char* tu1_hashed = SPH("super");
+const char* tu1_header_greeting = header_greeting();
@@ -0,0 +1,22 @@
+#include <spool.h>
+
+// Literal forms the spooler must scan like the compiler does. None of the quotes, apostrophes or SP("...") uses in
+// comments, character literals or raw strings below may be mistaken for a pooled literal.
+
+/* A block comment with a "quote, an apostrophe ' and SP("not pooled") */
+const char quote_char = '"';
+const char apostrophe_char = '\'';
+const int separated = 1'000'000 + 0xff'ff;
+const char* ignored_raw = R"tag(SP("not pooled") )" " )tag";
+
+const char* tu2_raw = SP(R"(C:\path "quoted")");
+const char* tu2_raw_delimited = SP(R"x(a)"b)x");
+const char* tu2_u8 = SP(u8"super");
+const char* tu2_joined = SP("sup" /* comment */ R"(er)");
+// Numeric escapes end with their segment rather than absorbing the characters that start the next
+const char* tu2_hex_joined = SP("\x4" "1");
+const char* tu2_octal_joined = SP("\1" "2");
+const char* tu2_hex_raw_joined = SP("\x4" R"(1)");
+// Line comments continued by a splice are covered by the spooler's parser tests, since compilers warn about them
+const char* tu2_spliced = SP("dup\
+er");
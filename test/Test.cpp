@@ -0,0 +1,25 @@
+#include "Test.hpp"
+
+#include <cstdio>
+
+static size_t test_count = 0;
+static size_t test_passes = 0;
+
+void test(bool condition, const char* cond_str, const char* file, int line)
+{
+    ++test_count;
+    if (condition)
+    {
+        ++test_passes;
+    }
+    else
+    {
+        printf("[%s:%d] Test failed: %s\n", file, line, cond_str);
+    }
+}
+
+int test_report()
+{
+    printf("%zu out of %zu tests passed.\n", test_passes, test_count);
+    return test_passes == test_count ? 0 : 1;
+}
@@ -2,4 +2,7 @@
 
 void test(bool condition, const char* cond_str, const char* file, int line);
 
+// Prints a summary of all tests run so far and returns the process exit code
+int test_report();
+
 #define TEST(condition) test(condition, #condition, __FILE__, __LINE__);
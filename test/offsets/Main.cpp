@@ -0,0 +1,35 @@
+#include <spool.h>
+
+#include "../Test.hpp"
+#include <cstring>
+
+extern const char* offsets_tu1_foo;
+extern const char* offsets_tu1_bar;
+
+int main(int argc, char** argv)
+{
+    const char* foo = SP("super");
+    const char* bar = SP("duper");
+    TEST(foo == offsets_tu1_foo);
+    TEST(bar == offsets_tu1_bar);
+    TEST(foo != bar);
+    TEST(strcmp(foo, "super") == 0);
+    TEST(strcmp(bar, "duper") == 0);
+    TEST(spool_len(foo) == 5);
+    TEST(spool_hash(foo) != spool_hash(bar));
+
+    // A suffix of other pooled strings is stored as the tail of one of them, but remains a string of its own
+    const char* per = SP("per");
+    TEST(per == foo + 2 || per == bar + 2);
+    TEST(strcmp(per, "per") == 0);
+    TEST(spool_len(per) == 3);
+    TEST(spool_hash(per) == spool_hash_bytes("per", 3));
+    TEST(spool_find("per", 3) == per);
+    TEST(spool_find("super", 5) == foo);
+    TEST(spool::id{per} != spool::id{foo} && spool::id{per} != spool::id{bar});
+    TEST(spool::id{per}.c_str() == per);
+    TEST(spool::id{bar}.c_str() == bar);
+    TEST(SPH("per") == per);
+
+    return test_report();
+}
@@ -0,0 +1,4 @@
+#include <spool.h>
+
+const char* offsets_tu1_foo = SP("super");
+const char* offsets_tu1_bar = SP("duper");
@@ -0,0 +1,13 @@
+#include <spool.h>
+
+#include "Shared.hpp"
+
+const char* shared_lib1_super()
+{
+    return SP("super");
+}
+
+const char* shared_lib1_duper()
+{
+    return SP("duper");
+}
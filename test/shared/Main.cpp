@@ -0,0 +1,39 @@
+#include <spool.h>
+
+#include "../Test.hpp"
+#include "Shared.hpp"
+#include <cstring>
+
+#ifdef SPOOL_TEST_PLUGIN
+#include <dlfcn.h>
+#endif
+
+int main(int argc, char** argv)
+{
+    // Every module of the spool uses the tables of its shared library, so pooled strings compare equal by pointer
+    // across modules
+    const char* super = SP("super");
+    const char* duper = SP("duper");
+    TEST(shared_lib1_super() == super);
+    TEST(shared_lib2_super() == super);
+    TEST(shared_lib1_duper() == duper);
+    TEST(shared_lib2_hashed() == duper);
+    TEST(strcmp(super, "super") == 0);
+    TEST(spool_len(shared_lib1_super()) == 5);
+    TEST(spool_find("duper", 5) == shared_lib1_duper());
+    TEST(spool::id{shared_lib2_super()} == spool::id{super});
+
+#ifdef SPOOL_TEST_PLUGIN
+    // Including modules loaded at runtime without adding their symbols to the global scope
+    void* plugin = dlopen(SPOOL_TEST_PLUGIN, RTLD_NOW | RTLD_LOCAL);
+    TEST(plugin != nullptr);
+    if (plugin)
+    {
+        auto plugin_super = reinterpret_cast<const char* (*)()>(dlsym(plugin, "shared_plugin_super"));
+        TEST(plugin_super != nullptr && plugin_super() == super);
+        dlclose(plugin);
+    }
+#endif
+
+    return test_report();
+}
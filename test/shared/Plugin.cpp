@@ -0,0 +1,8 @@
+#include <spool.h>
+
+#include "Shared.hpp"
+
+const char* shared_plugin_super()
+{
+    return SP("super");
+}
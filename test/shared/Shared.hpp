@@ -0,0 +1,16 @@
+#pragma once
+
+// The modules of this test hide their symbols by default, so the functions called across modules are exported
+#ifdef _WIN32
+#define SHARED_TEST_API
+#else
+#define SHARED_TEST_API __attribute__((visibility("default")))
+#endif
+
+SHARED_TEST_API const char* shared_lib1_super();
+SHARED_TEST_API const char* shared_lib1_duper();
+SHARED_TEST_API const char* shared_lib2_super();
+SHARED_TEST_API const char* shared_lib2_hashed();
+
+// Looked up with dlsym
+extern "C" SHARED_TEST_API const char* shared_plugin_super();
@@ -0,0 +1,122 @@
+#include "../Test.hpp"
+#include "Tests.hpp"
+
+#include "Daemon.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+void test_daemon()
+{
+    // There is no daemon on Windows, so every command runs in the client
+    char command[] = "spooler";
+    char* argv[] = {command, nullptr};
+    int result = 0;
+    TEST(!run_in_daemon("spooler.sock", 1, argv, result));
+}
+
+#else
+
+// Runs args in the daemon with this process's stdout redirected to output_path
+static bool run_captured(const std::string& socket_path, std::vector<std::string> args, const std::string& output_path,
+                         int& result)
+{
+    std::vector<char*> argv;
+    for (auto& arg : args)
+    {
+        argv.emplace_back(arg.data());
+    }
+    argv.emplace_back(nullptr);
+
+    std::fflush(stdout);
+    int saved_out = dup(STDOUT_FILENO);
+    int output = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(output, STDOUT_FILENO);
+    close(output);
+
+    bool ran = run_in_daemon(socket_path.c_str(), static_cast<int>(args.size()), argv.data(), result);
+
+    std::fflush(stdout);
+    dup2(saved_out, STDOUT_FILENO);
+    close(saved_out);
+    return ran;
+}
+
+void test_daemon()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string prefix = (directory / ("spooler_test_" + std::to_string(getpid()))).string();
+    std::string socket_path = prefix + ".sock";
+    std::string output_path = prefix + ".out";
+    int result = 0;
+
+    // Nothing is serving yet
+    TEST(!run_captured(socket_path, {"spooler", "compact", "a.spool"}, output_path, result));
+
+    pid_t server = fork();
+    if (server == 0)
+    {
+        // Prints its working directory and arguments to the client, and exits with the number of arguments
+        int served = serve(socket_path.c_str(), [](int argc, char** argv) {
+            std::vector<char> cwd(4096);
+            printf("%s", getcwd(cwd.data(), cwd.size()) ? cwd.data() : "");
+            for (int i = 0; i != argc; ++i)
+            {
+                printf(" %s", argv[i]);
+            }
+            return argc;
+        });
+        _exit(served);
+    }
+
+    // The command runs in the working directory of the client
+    std::filesystem::path original = std::filesystem::current_path();
+    std::filesystem::current_path(directory);
+    std::string client_cwd = std::filesystem::current_path().string();
+
+    bool ran = false;
+    auto start = std::chrono::steady_clock::now();
+    while (!ran && std::chrono::steady_clock::now() - start < std::chrono::seconds{10})
+    {
+        ran = run_captured(socket_path, {"spooler", "compact", "a.spool"}, output_path, result);
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    TEST(ran);
+    TEST(result == 3);
+    std::ifstream output{output_path};
+    std::string printed{std::istreambuf_iterator<char>{output}, std::istreambuf_iterator<char>{}};
+    TEST(printed == client_cwd + " spooler compact a.spool");
+
+    // The daemon keeps serving one command after another
+    TEST(run_captured(socket_path, {"spooler", "generate", "a.spool", "a.cpp", "--offsets"}, output_path, result));
+    TEST(result == 5);
+
+    std::filesystem::current_path(original);
+
+    // Once the daemon is gone, clients run their commands themselves
+    kill(server, SIGTERM);
+    int status = 0;
+    waitpid(server, &status, 0);
+    TEST(!run_captured(socket_path, {"spooler", "compact", "a.spool"}, output_path, result));
+
+    std::error_code error;
+    std::filesystem::remove(socket_path, error);
+    std::filesystem::remove(output_path, error);
+}
+
+#endif
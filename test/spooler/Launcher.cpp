@@ -0,0 +1,64 @@
+#include "../Test.hpp"
+#include "Tests.hpp"
+
+#include "Launcher.hpp"
+
+#include <string>
+#include <vector>
+
+struct Parsed
+{
+    std::string source;
+    int source_id;
+};
+
+// Parses a compiler command line, with an empty source if there is none
+static Parsed parse(std::vector<std::string> args)
+{
+    std::vector<char*> argv;
+    for (auto& arg : args)
+    {
+        argv.emplace_back(arg.data());
+    }
+    argv.emplace_back(nullptr);
+
+    CompileCommand command = parse_compile_command(static_cast<int>(args.size()), argv.data());
+    return {command.source ? command.source : "", command.source_id};
+}
+
+void test_launcher()
+{
+    // As generated by CMake for GCC and Clang
+    Parsed gcc = parse({"c++", "-DSPOOL_ID=3", "-I/include", "-O2", "-o", "TU1.cpp.o", "-c", "/src/TU1.cpp"});
+    TEST(gcc.source == "/src/TU1.cpp");
+    TEST(gcc.source_id == 3);
+
+    Parsed separate = parse({"c++", "-D", "SPOOL_ID=12", "-c", "TU1.cpp"});
+    TEST(separate.source == "TU1.cpp");
+    TEST(separate.source_id == 12);
+
+    // Other definitions, including ones that merely start with the same name, don't spool the source
+    Parsed other = parse({"c++", "-DSPOOL_IDX=1", "-D", "FOO=2", "-c", "TU1.cpp"});
+    TEST(other.source == "TU1.cpp");
+    TEST(other.source_id == -1);
+
+    Parsed last = parse({"c++", "-c", "TU1.cpp", "-D"});
+    TEST(last.source_id == -1);
+
+    Parsed several = parse({"c++", "-DSPOOL_ID=1", "-c", "TU1.cpp", "-c", "TU2.cpp"});
+    TEST(several.source.empty());
+    TEST(several.source_id == 1);
+
+    // Linking, or -c directly followed by another flag
+    TEST(parse({"c++", "-o", "spool_test", "TU1.cpp.o"}).source.empty());
+    TEST(parse({"c++", "-c", "-o", "TU1.cpp.o"}).source.empty());
+
+    // As generated by CMake for MSVC, which accepts both flag prefixes
+    Parsed msvc = parse({"cl.exe", "/nologo", "/TP", "/DSPOOL_ID=7", "/FoTU1.cpp.obj", "/FS", "-c", "C:\\src\\TU1.cpp"});
+    TEST(msvc.source == "C:\\src\\TU1.cpp");
+    TEST(msvc.source_id == 7);
+
+    Parsed msvc_separate = parse({"cl.exe", "/D", "SPOOL_ID=8", "/c", "TU1.cpp"});
+    TEST(msvc_separate.source == "TU1.cpp");
+    TEST(msvc_separate.source_id == 8);
+}
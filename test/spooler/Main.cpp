@@ -0,0 +1,10 @@
+#include "../Test.hpp"
+#include "Tests.hpp"
+
+int main(int argc, char** argv)
+{
+    test_parser();
+    test_launcher();
+    test_daemon();
+    return test_report();
+}
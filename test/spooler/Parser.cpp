@@ -0,0 +1,30 @@
+#include "../Test.hpp"
+#include "Tests.hpp"
+
+#include "Parser.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+static std::vector<std::string_view> parse(const std::string& contents)
+{
+    Parser parser{contents.data(), contents.size(), "SP"};
+    parser.parse();
+    return parser.literals();
+}
+
+void test_parser()
+{
+    // A line comment ending in a splice continues onto the next line, which compilers warn about in real sources
+    std::string spliced_comment = "const char* a = SP(\"before\"); // SP(\"not pooled\") \\\n"
+                                  "   SP(\"still not pooled\")\n"
+                                  "const char* b = SP(\"after\");\n";
+    std::vector<std::string_view> literals = parse(spliced_comment);
+    TEST(literals.size() == 2 && literals[0] == "before" && literals[1] == "after");
+
+    // Also with Windows line endings
+    std::string crlf = "// SP(\"not pooled\") \\\r\n   SP(\"still not pooled\")\r\nSP(\"after\")\r\n";
+    literals = parse(crlf);
+    TEST(literals.size() == 1 && literals[0] == "after");
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Unit tests of the spooler's internals, each reporting through TEST
+
+// Parser on sources that can't be compiled without warnings
+void test_parser();
+
+// parse_compile_command on the compiler command lines CMake generates
+void test_launcher();
+
+// A command run by `spooler serve` on behalf of a client, over a socket in the temporary directory
+void test_daemon();